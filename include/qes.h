@@ -9,8 +9,13 @@
 #define QES_h
 
 #include "qes/lang/instruction.h"
+#include "qes/lang/shard.h"
+#include "qes/lang/source_map.h"
+#include "qes/lang/writer.h"
+#include "qes/util/profile.h"
 
 #include <iostream>
+#include <memory>
 
 namespace qes {
 
@@ -25,9 +30,50 @@ namespace qes {
 Program<>   safe_read_from_file(std::string);
 Program<>   fast_read_from_file(std::string);
 
-Program<>   from_file(std::string); // alias for fast_read_from_file.
+// These versions also record per-phase statistics into the io_stats_t (see
+// qes/util/profile.h). Statistics are only collected if qes was compiled with
+// QES_PROFILE.
+Program<>   safe_read_from_file(std::string, io_stats_t&);
+Program<>   fast_read_from_file(std::string, io_stats_t&);
 
-void        to_file(std::string, const Program<>&);
+// Reads the program into the memory resource (see pmr::Program in
+// qes/lang/instruction.h).
+pmr::Program<>  fast_read_from_file(std::string, std::pmr::memory_resource*);
+
+// These versions also record the source location of each instruction (see
+// qes/lang/source_map.h).
+Program<>   safe_read_from_file(std::string, SourceMap&);
+Program<>   fast_read_from_file(std::string, SourceMap&);
+
+// from_file is an alias for fast_read_from_file. If the parse cache is enabled
+// (see qes/util/parse_cache.h), it goes through the cache instead.
+Program<>   from_file(std::string);
+
+// Relative includes (include "path";) in the file are resolved against the
+// file's directory (see qes/lang/module.h).
+//
+// Compressed files (gzip or zstd) are decompressed transparently on reads. On
+// writes, the output is compressed if the file ends in ".gz" or ".zst".
+//
+// to_file formats the program on n_threads threads (see qes/lang/writer.h). The
+// output is identical for any number of threads.
+void        to_file(std::string, const Program<>&, size_t n_threads=0);
+// With an io_stats_t, the "format" and "write" phases of write_prog are
+// recorded (see qes/lang/writer.h).
+void        to_file(std::string, const Program<>&, io_stats_t&);
+// With write_mode_t::rerolled, periodic runs are written as repeat blocks (see
+// qes/lang/writer.h).
+void        to_file(std::string, const Program<>&, write_mode_t);
+
+// to_files shards the program across files, in parallel (see qes/lang/shard.h):
+// shard k is written to <prefix>.<k>.qes, and the manifest to <prefix>.manifest.
+// from_files reads the manifest and reassembles the program.
+//
+//      to_files("out/circuit", program, range_partitioner(8));
+//      Program<> same = from_files("out/circuit.manifest");
+void        to_files(std::string prefix, const Program<>&, const partitioner_t&,
+                write_mode_t mode=write_mode_t::rerolled);
+Program<>   from_files(std::string manifest);
 
 std::ostream& operator<<(std::ostream&, const Instruction<>&);
 std::ostream& operator<<(std::ostream&, const Program<>&);
@@ -4,33 +4,124 @@
  * */
 
 #include "qes/lang/safe_parse.h"
+#include "qes/lang/block.h"
+#include "qes/lang/expression.h"
 #include "qes/lang/fast_parse.h"
-
-#include <fstream>
+#include "qes/lang/footprint.h"
+#include "qes/lang/incremental_parse.h"
+#include "qes/lang/index.h"
+#include "qes/lang/intern.h"
+#include "qes/lang/module.h"
+#include "qes/lang/passes.h"
+#include "qes/lang/pipeline.h"
+#include "qes/lang/query_index.h"
+#include "qes/lang/qubit_index.h"
+#include "qes/lang/schedule.h"
+#include "qes/lang/shard.h"
+#include "qes/lang/source_map.h"
+#include "qes/lang/stats.h"
+#include "qes/lang/writer.h"
+#include "qes/util/compression.h"
+#include "qes/util/parse_cache.h"
+#include "qes/util/readahead.h"
 
 namespace qes {
 
 inline Program<>
 safe_read_from_file(std::string input_file) {
-    std::ifstream fin(input_file);
+    IncludeGuard guard(input_file);
+    compressed_ifstream fin(input_file);
     return safe_read_program(fin);
 }
 
 inline Program<>
 fast_read_from_file(std::string input_file) {
-    std::ifstream fin(input_file);
+    IncludeGuard guard(input_file);
+    compressed_ifstream fin(input_file);
     return fast_read_program(fin);
 }
 
+inline Program<>
+safe_read_from_file(std::string input_file, io_stats_t& stats) {
+    IncludeGuard guard(input_file);
+    compressed_ifstream fin(input_file);
+    return safe_read_program(fin, &stats);
+}
+
+inline Program<>
+fast_read_from_file(std::string input_file, io_stats_t& stats) {
+    IncludeGuard guard(input_file);
+    compressed_ifstream fin(input_file);
+    return fast_read_program(fin, &stats);
+}
+
+inline pmr::Program<>
+fast_read_from_file(std::string input_file, std::pmr::memory_resource* mem) {
+    IncludeGuard guard(input_file);
+    compressed_ifstream fin(input_file);
+    return fast_read_program(fin, mem);
+}
+
+inline Program<>
+safe_read_from_file(std::string input_file, SourceMap& locations) {
+    IncludeGuard guard(input_file);
+    compressed_ifstream fin(input_file);
+    return safe_read_program(fin, locations);
+}
+
+inline Program<>
+fast_read_from_file(std::string input_file, SourceMap& locations) {
+    IncludeGuard guard(input_file);
+    compressed_ifstream fin(input_file);
+    return fast_read_program(fin, locations);
+}
+
 inline Program<>
 from_file(std::string f) {
+    if (parse_cache_is_enabled()) return cached_read_from_file(f);
     return fast_read_from_file(f);
 }
 
 inline void
-to_file(std::string output_file, const Program<>& prog) {
-    std::ofstream fout(output_file);
-    fout << prog << std::endl;
+to_file(std::string output_file, const Program<>& prog, size_t n_threads) {
+    compressed_ofstream fout(output_file);
+    write_prog(fout, prog, n_threads);
+    fout << std::endl;
+}
+
+inline void
+to_file(std::string output_file, const Program<>& prog, io_stats_t& stats) {
+    auto fout = std::make_unique<compressed_ofstream>(output_file);
+    write_prog(*fout, prog, 0, 4096, &stats);
+    QES_IF_PROFILE(
+        phase_stats_t* write_phase = &stats.get("write");
+        PhaseTimer timer(write_phase);
+        write_phase->bytes++;
+    )
+    *fout << std::endl;
+    // Closing the file flushes (and compresses) what remains of it.
+    fout.reset();
+}
+
+inline void
+to_file(std::string output_file, const Program<>& prog, write_mode_t mode) {
+    if (mode == write_mode_t::flat) {
+        to_file(output_file, prog);
+        return;
+    }
+    compressed_ofstream fout(output_file);
+    write_rerolled_prog(fout, prog);
+    fout << std::endl;
+}
+
+inline void
+to_files(std::string prefix, const Program<>& prog, const partitioner_t& p, write_mode_t mode) {
+    write_shards(prefix, prog, p, mode);
+}
+
+inline Program<>
+from_files(std::string manifest) {
+    return read_shards(manifest);
 }
 
 inline std::ostream&
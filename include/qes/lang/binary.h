@@ -0,0 +1,44 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_BINARY_h
+#define QES_BINARY_h
+
+#include "qes/lang/instruction.h"
+
+#include <iostream>
+
+#include <stdint.h>
+
+namespace qes {
+
+// A compact binary serialization of Program<>. The format is a header (magic
+// "QESB" and a format version) followed by one record per instruction, so
+// programs can be written and read one instruction at a time.
+//
+// Integers are stored as zigzag varints, doubles as their 8 raw bytes, and
+// strings as a varint length followed by their bytes. Each instruction record
+// is:
+//      name, #operands, operands, #annotations, annotations, #properties,
+//      (key, value) pairs
+// where each operand or property value is a type tag followed by its value.
+const uint32_t QES_BINARY_FORMAT_VERSION = 1;
+
+void    write_binary_header(std::ostream&);
+void    write_binary_inst(std::ostream&, const Instruction<>&);
+void    write_binary_program(std::ostream&, const Program<>&);
+
+// Returns false if the stream does not start with a valid header.
+bool    read_binary_header(std::istream&);
+// Returns false if there are no more instructions. If the next record is
+// invalid or truncated, this also returns false, and sets the stream's failbit
+// (which a clean end of the stream does not).
+bool    read_binary_inst(std::istream&, Instruction<>&);
+// Exits if the stream is not a valid binary program.
+Program<>   read_binary_program(std::istream&);
+
+}   // qes
+
+#endif  // QES_BINARY_h
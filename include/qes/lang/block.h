@@ -0,0 +1,130 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_BLOCK_h
+#define QES_BLOCK_h
+
+#include "qes/lang/expression.h"
+#include "qes/lang/fast_parse.h"
+#include "qes/lang/instruction.h"
+#include "qes/lang/source_map.h"
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+
+namespace qes {
+
+struct parse_scope_t;
+struct subroutine_t;
+
+// block_t is a repeat-compressed program: the body of a block is run
+// repeat_count times. The body is a sequence of instructions and nested
+// blocks, which are stored separately: subblocks[i] comes right after the
+// first subblock_pos[i] instructions of the body.
+//
+//      h 0;
+//      repeat (100) { cx 0, 1; repeat (2) { x 1; } }
+//      measure 0;
+//
+// is a block (repeat_count = 1) with instructions [ h, measure ], and one
+// subblock (at position 1) with instructions [ cx ] and one subblock (at
+// position 1) with instructions [ x ].
+//
+// If the block has a loop variable (repeat (i, N) { ... }), its body may use
+// the variable in expressions (see qes/lang/expression.h), and the variable is
+// 0, 1, ..., N-1 in each iteration. Expressions are kept unevaluated until the
+// block is expanded.
+//
+// If the block is a call to a subroutine (call name(args);), its body is the
+// body of the subroutine, which is shared by all calls rather than copied, and
+// the parameters of the subroutine are bound to args (which may be expressions
+// over the loop variables of the enclosing blocks).
+struct block_t {
+    constexpr static uint32_t NO_LOOP_VAR = UINT32_MAX;
+
+    int64_t                 repeat_count = 1;
+    uint32_t                loop_var = NO_LOOP_VAR;   // The id of the interned name.
+    Program<>               instructions;
+    std::vector<block_t>    subblocks;
+    std::vector<size_t>     subblock_pos;
+
+    std::shared_ptr<const subroutine_t> subroutine;
+    std::vector<any_t>                  args;
+
+    bool    operator==(const block_t&) const;
+    // Removes the body (but keeps the capacity of its arrays).
+    void    clear(void);
+};
+
+// A subroutine is defined once (def name(params) { ... }) and can then be
+// called any number of times. Its body is parsed once, and is expanded at each
+// call with the parameters bound to the arguments.
+struct subroutine_t {
+    std::string             name;
+    std::vector<uint32_t>   params;     // The ids of the interned names.
+    block_t                 body;
+    uint64_t                expanded_size;
+
+    bool    operator==(const subroutine_t&) const;
+};
+
+typedef std::map<std::string, std::shared_ptr<const subroutine_t>> subroutine_table_t;
+
+// Returns the statements of the block: for a call, these are the statements
+// of the subroutine's body.
+const block_t&  get_body(const block_t&);
+// Pushes the bindings of the parameters of a call onto ctx (the arguments are
+// evaluated with ctx). Returns the number of bindings pushed.
+size_t          push_call_bindings(const block_t&, loop_context_t& ctx);
+
+// Reads a program like fast_read_program, but does not expand repeat blocks or
+// calls. The scope (see qes/lang/fast_parse_impl.h) has the loop variables
+// and subroutines that can be used. If it is null, neither can be used.
+block_t read_compressed_program(std::istream&);
+block_t read_compressed_block(std::istream&, debug_state_t&, const parse_scope_t* scope=nullptr,
+            std::vector<source_location_t>* locations=nullptr);
+// Reads one statement (an instruction, repeat block, call, or definition) and
+// appends it to the block (definitions are added to the scope's subroutines
+// instead). Returns false if the input or the enclosing block ended first.
+//
+// If locations is not null, the location of each instruction and call that is
+// read is appended to it, in the order they appear in the source (so the
+// statements of a repeat block come right after those before the block).
+bool    read_compressed_statement(std::istream&, debug_state_t&, block_t&, const parse_scope_t* scope=nullptr,
+            std::vector<source_location_t>* locations=nullptr);
+// Reads a program one top-level statement at a time, and calls f on each
+// (instruction, repeat block, or call) as a block with just that statement.
+// Only the statement and the subroutines defined so far are held, so this
+// takes memory proportional to the largest statement rather than the program.
+void    for_each_read_statement(std::istream&, std::function<void(const block_t&)> f);
+
+// Returns the number of instructions in the expanded program.
+uint64_t    get_expanded_size(const block_t&);
+// The expansion functions evaluate all expressions, with the variables of any
+// enclosing blocks given by ctx.
+Program<>   expand(const block_t&, const loop_context_t& ctx={});
+// Appends the expanded program to out. A block without a loop variable is
+// expanded once, and then copied for its remaining repeats.
+void    append_expanded(const block_t&, Program<>& out, const loop_context_t& ctx={});
+// Appends instructions [begin, end) of the expanded program to out. Only the
+// needed iterations of each repeat block are expanded.
+void    expand_range(const block_t&, uint64_t begin, uint64_t end, Program<>& out, const loop_context_t& ctx={});
+// Calls f(Instruction<>&&) on each instruction of the expanded program, in
+// order, without materializing the program.
+template <class FUNC> void for_each_expanded(const block_t&, FUNC, loop_context_t ctx={});
+
+// Calls inst_fn(const Instruction<>&) and block_fn(const block_t&) on each
+// statement in the body of the block (not recursively), in order. For a call,
+// these are the statements of the subroutine's body.
+template <class INST_FUNC, class BLOCK_FUNC>
+void for_each_statement(const block_t&, INST_FUNC, BLOCK_FUNC);
+
+}   // qes
+
+#include "block.inl"
+
+#endif  // QES_BLOCK_h
@@ -0,0 +1,84 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+inline bool
+block_t::operator==(const block_t& other) const {
+    return repeat_count == other.repeat_count
+        && loop_var == other.loop_var
+        && instructions == other.instructions
+        && subblocks == other.subblocks
+        && subblock_pos == other.subblock_pos
+        && (subroutine == other.subroutine
+                || (subroutine != nullptr && other.subroutine != nullptr && *subroutine == *other.subroutine))
+        && args == other.args;
+}
+
+inline void
+block_t::clear() {
+    instructions.clear();
+    subblocks.clear();
+    subblock_pos.clear();
+}
+
+inline bool
+subroutine_t::operator==(const subroutine_t& other) const {
+    return name == other.name && params == other.params && body == other.body;
+}
+
+inline const block_t&
+get_body(const block_t& blk) {
+    return blk.subroutine == nullptr ? blk : blk.subroutine->body;
+}
+
+inline size_t
+push_call_bindings(const block_t& blk, loop_context_t& ctx) {
+    if (blk.subroutine == nullptr) return 0;
+    const std::vector<uint32_t>& params = blk.subroutine->params;
+    // Evaluate all arguments before binding any parameter.
+    int64_t small_values[8];
+    std::vector<int64_t> big_values;
+    int64_t* values = small_values;
+    if (params.size() > 8) {
+        big_values.resize(params.size());
+        values = big_values.data();
+    }
+    for (size_t i = 0; i < params.size(); i++) values[i] = get<int64_t>(evaluate(blk.args[i], ctx));
+    for (size_t i = 0; i < params.size(); i++) ctx.push_back({params[i], values[i]});
+    return params.size();
+}
+
+template <class INST_FUNC, class BLOCK_FUNC> void
+for_each_statement(const block_t& _blk, INST_FUNC inst_fn, BLOCK_FUNC block_fn) {
+    const block_t& blk = get_body(_blk);
+    size_t k = 0;
+    for (size_t i = 0; i < blk.instructions.size(); i++) {
+        while (k < blk.subblocks.size() && blk.subblock_pos[k] == i) {
+            block_fn(blk.subblocks[k++]);
+        }
+        inst_fn(blk.instructions[i]);
+    }
+    while (k < blk.subblocks.size()) block_fn(blk.subblocks[k++]);
+}
+
+template <class FUNC> void
+for_each_expanded(const block_t& blk, FUNC f, loop_context_t ctx) {
+    push_call_bindings(blk, ctx);
+    const bool has_var = blk.loop_var != block_t::NO_LOOP_VAR;
+    if (has_var) ctx.push_back({blk.loop_var, 0});
+    for (int64_t i = 0; i < blk.repeat_count; i++) {
+        if (has_var) ctx.back().value = i;
+        for_each_statement(blk,
+            [&] (const Instruction<>& inst) {
+                Instruction<> x(inst);
+                if (!ctx.empty()) evaluate(x, ctx);
+                f(std::move(x));
+            },
+            [&] (const block_t& sub) { for_each_expanded(sub, f, ctx); });
+    }
+}
+
+}   // qes
@@ -0,0 +1,110 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_EXPRESSION_h
+#define QES_EXPRESSION_h
+
+#include "qes/lang/instruction.h"
+#include "qes/util/token.h"
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+
+namespace qes {
+
+// Operands and property values may be integer expressions over the variables
+// of enclosing repeat blocks:
+//
+//      repeat (i, 10) {
+//          @property round i
+//          cx i, i+1;
+//      }
+//
+// An expression is stored in reverse Polish notation. Variables are stored by
+// the id of their (interned) name.
+struct expr_op_t {
+    enum kind_t : uint8_t { CONST, VAR, ADD, SUB, MUL, DIV, MOD, NEG };
+
+    kind_t  kind;
+    int64_t value;  // The constant (CONST) or the name id of the variable (VAR).
+
+    bool operator==(const expr_op_t& other) const { return kind == other.kind && value == other.value; }
+};
+
+typedef std::vector<expr_op_t> expr_t;
+
+// The values of the loop variables of the enclosing repeat blocks, innermost
+// last.
+struct loop_binding_t {
+    uint32_t    var;
+    int64_t     value;
+};
+
+typedef std::vector<loop_binding_t> loop_context_t;
+
+// An unevaluated expression is held by the values that refer to it (see
+// value_t), and is freed with the last of them.
+struct shared_expr_t {
+    mutable std::atomic<uint32_t>   refs;
+    expr_t                          expr;
+};
+
+bool            is_expression_ref(const any_t&);
+const expr_t&   get_expression(const any_t&);
+
+// Parses the tokens of an expression (integer literals, identifiers, + - * /
+// %, unary minus, and parentheses). Returns false on a syntax error.
+bool    parse_expression(const std::vector<Token>&, expr_t&);
+
+// Returns true if every variable of the expression is in loop_vars (a list of
+// name ids).
+bool    all_variables_bound(const expr_t&, const std::vector<uint32_t>& loop_vars);
+bool    uses_variables(const expr_t&);
+// Returns a constant (if the expression does not use any variables), or a
+// reference to the registered expression.
+any_t   make_expression_value(expr_t);
+
+// Division and modulo truncate (as in C++). Exits if a variable is unbound, if
+// there is a division by zero, or if the result (or any intermediate value)
+// does not fit in an int64_t.
+int64_t evaluate(const expr_t&, const loop_context_t&);
+// Replaces any expression references in the value or instruction with their
+// values.
+any_t   evaluate(const any_t&, const loop_context_t&);
+void    evaluate(Instruction<>&, const loop_context_t&);
+
+// The range [lo, hi] of values a variable takes (e.g., [0, N-1] for the loop
+// variable of a repeat (i, N) block).
+struct var_range_t {
+    uint32_t    var;
+    int64_t     lo;
+    int64_t     hi;
+};
+
+// Returns bounds [lo, hi] on the values of the expression over all values of
+// its variables (the innermost range of each variable is used), by interval
+// arithmetic in time proportional to the size of the expression. The bounds
+// are exact if every variable appears once and there is no / or %. Otherwise
+// they may be wider than the actual range: for example, i-i is bounded by
+// [-9, 9] for i in [0, 9], as each use of i is bounded separately.
+std::pair<int64_t, int64_t> get_range(const expr_t&, const std::vector<var_range_t>&);
+
+// Substitutes one variable, and returns the resulting constant or (if other
+// variables remain) a new expression.
+any_t   substitute(const any_t&, uint32_t var, int64_t value);
+
+bool    has_expressions(const Instruction<>&);
+
+std::string print_expression(const expr_t&);
+
+}   // qes
+
+#include "expression.inl"
+
+#endif  // QES_EXPRESSION_h
@@ -0,0 +1,38 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+inline bool
+is_expression_ref(const any_t& x) {
+    return x.is_expression();
+}
+
+inline const expr_t&
+get_expression(const any_t& x) {
+    return x.get_expression()->expr;
+}
+
+inline any_t
+evaluate(const any_t& x, const loop_context_t& ctx) {
+    if (!is_expression_ref(x)) return x;
+    return evaluate(get_expression(x), ctx);
+}
+
+inline void
+evaluate(Instruction<>& inst, const loop_context_t& ctx) {
+    inst.update_values([&] (any_t& x) {
+        if (is_expression_ref(x)) x = evaluate(x, ctx);
+    });
+}
+
+inline bool
+has_expressions(const Instruction<>& inst) {
+    bool found = false;
+    inst.for_each_value([&] (const any_t& x) { found |= is_expression_ref(x); });
+    return found;
+}
+
+}   // qes
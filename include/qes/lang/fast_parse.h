@@ -7,22 +7,46 @@
 #define QES_FAST_PARSE_h
 
 #include "qes/lang/instruction.h"
+#include "qes/util/profile.h"
 #include "qes/util/token.h"
 
 #include <iostream>
 
 namespace qes {
 
+struct parse_scope_t;
+class QubitIndex;
+class SourceMap;
+
 struct debug_state_t {
     size_t line;
     size_t col;
+    size_t bytes = 0;   // Number of characters consumed.
 };
 
 std::ostream& operator<<(std::ostream&, const debug_state_t&);
 
-Program<> fast_read_program(std::istream&);
-
-Program<> read_block(std::istream&, debug_state_t&);
+// If stats is not null (and QES_PROFILE is defined), the time spent in the
+// tokenizer, the state machine, and repeat expansion is recorded.
+Program<> fast_read_program(std::istream&, io_stats_t* stats=nullptr);
+// Also builds the qubit index of the program (see qes/lang/qubit_index.h). The
+// index must be empty. Instructions are indexed as each statement is parsed,
+// while they are still in cache.
+Program<> fast_read_program(std::istream&, QubitIndex&, io_stats_t* stats=nullptr);
+// Also records the source location of each instruction (see
+// qes/lang/source_map.h). The map must be empty.
+Program<> fast_read_program(std::istream&, SourceMap&, io_stats_t* stats=nullptr);
+
+// Reads the program into the memory resource (see pmr::Program in
+// qes/lang/instruction.h). Each statement is expanded into the program as soon
+// as it is read, so only the program itself is allocated from the resource.
+pmr::Program<> fast_read_program(std::istream&, std::pmr::memory_resource*);
+
+// If scope is null, then the block is the top level of the program. If qubits
+// is not null, the instructions of the block are added to it, and likewise for
+// their locations.
+Program<> read_block(std::istream&, debug_state_t&, io_stats_t* stats=nullptr,
+            const parse_scope_t* scope=nullptr, QubitIndex* qubits=nullptr, SourceMap* locations=nullptr);
 Token read_next_token(std::istream&, debug_state_t&);
 
 }   // qes
@@ -6,8 +6,11 @@
 #ifndef QES_FAST_PARSE_IMPL_h
 #define QES_FAST_PARSE_IMPL_h
 
+#include "qes/lang/block.h"
 #include "qes/lang/fast_parse.h"
 
+#include <algorithm>
+
 namespace qes {
 
 enum class status_t {
@@ -18,11 +21,27 @@ enum class status_t {
     in_property,
     in_label,
     in_repeat,
+    in_definition,
+    in_include,
     enter_subblock,
+    enter_definition,
+    call_subroutine,
     exit_block,
     invalid
 };
 
+// The names that can be used while reading a block: the loop variables in
+// scope (as interned name ids), and the subroutines defined so far. Subroutines
+// can only be defined if allow_definitions is set (i.e., at the top level).
+struct parse_scope_t {
+    std::vector<uint32_t>   loop_vars;
+    subroutine_table_t*     subroutines = nullptr;
+    bool                    allow_definitions = false;
+
+    // Returns the scope of a nested block (which may not define subroutines).
+    parse_scope_t   nested(void) const;
+};
+
 struct parse_state_t {
     Program<> program;
 
@@ -34,18 +53,37 @@ struct parse_state_t {
     std::string property_name;
 
     int64_t repeat_ctr;
+    // The loop variable of the repeat block being read (empty if none).
+    std::string repeat_var;
+
+    // The tokens of the operand or property value being read, and the depth of
+    // parentheses within it.
+    std::vector<Token> expr_tokens;
+    int expr_depth = 0;
+    // Expressions may only use the loop variables in scope, and calls may only
+    // use the subroutines in scope. May be null if there are neither.
+    const parse_scope_t* scope = nullptr;
+
+    // The subroutine being defined (def name(params) {), and the call that was
+    // just read.
+    std::string def_name;
+    std::vector<uint32_t> def_params;
+    block_t call;
+    // The path of the module being included (include "path";).
+    std::string include_path;
 
-    bool in_inst_awaiting_sep = false;
     bool in_property_awaiting_val = false;
     int in_repeat_awaiting_ctr_step = 0;
+    int in_def_step = 0;
 
     void reset() {
         inst_name.clear();
         inst_operands.clear();
         annotations.clear();
         property_map.clear();
+        expr_tokens.clear();
 
-        in_inst_awaiting_sep = false;
+        expr_depth = 0;
         in_property_awaiting_val = false;
         in_repeat_awaiting_ctr_step = 0;
     }
@@ -58,8 +96,84 @@ status_t parse_in_annotation(std::string, std::string, parse_state_t&);
 status_t parse_in_property(std::string, std::string, parse_state_t&);
 status_t parse_in_label(std::string, std::string, parse_state_t&);
 status_t parse_in_repeat(std::string, std::string, parse_state_t&);
+status_t parse_in_definition(std::string, std::string, parse_state_t&);
+// An include is read as a call to the module's body (see qes/lang/module.h).
+status_t parse_in_include(std::string, std::string, parse_state_t&);
+
+// Passes the token to the parse_* function for the given status.
+status_t parse_token(status_t, std::string type, std::string val, parse_state_t&);
+
+// The phases of a read that are timed if stats are requested (see
+// qes/util/profile.h). All are null if not.
+struct read_phases_t {
+    phase_stats_t*  tokenize = nullptr;
+    phase_stats_t*  state_machine = nullptr;
+    phase_stats_t*  repeat_expansion = nullptr;
+};
+
+read_phases_t   get_read_phases(io_stats_t*);
+
+// Reads one statement and appends it to the block: an instruction, a call, or
+// a repeat block (whose body is read compressed). A definition is added to the
+// subroutines of p_st.scope instead, and appends nothing. Returns false if the
+// input or the enclosing block ended first.
+//
+// This is the loop over tokens of every reader of the fast parser (except for
+// IncrementalParser, which is pushed its tokens). The readers keep p_st between
+// the statements of a block, so that its buffers keep their capacity. If
+// locations is not null, it is appended to as by read_compressed_statement.
+bool    read_statement(std::istream&, debug_state_t&, parse_state_t&, block_t&,
+            std::vector<source_location_t>* locations=nullptr, const read_phases_t& phases={});
 
 any_t get_literal_val(std::string, std::string);
+// Reserves space for n more instructions (in a Program<> or an
+// InternedProgram<>). The capacity grows geometrically, so that expanding many
+// blocks one after another takes linear time.
+template <class PROGRAM> void reserve_more(PROGRAM&, size_t n);
+// Returns the scope of the body of the subroutine being defined.
+parse_scope_t get_definition_scope(const parse_state_t&);
+// Adds the subroutine with the given body to the scope's subroutines. Exits if
+// a subroutine with the same name exists.
+void define_subroutine(const parse_state_t&, block_t body);
+
+// Converts st.expr_tokens (a literal or an expression over the loop variables
+// in scope) into a value, and clears them. Returns false if the tokens are not
+// a valid value.
+bool finish_value(parse_state_t&, any_t&);
+
+// The tokenizer of the fast parser, one character at a time. read_next_token
+// pulls characters from a stream into it, and IncrementalParser pushes them.
+class Tokenizer {
+public:
+    enum class scan_t {
+        more,       // The token continues.
+        end,        // The character ends the token (or is a token by itself).
+        end_before  // The token ended before the character, which must be scanned again.
+    };
+
+    // st is only used to report invalid characters.
+    scan_t  scan(char, const debug_state_t& st);
+    // Returns the token read so far (T_empty if none), and starts a new one.
+    Token   take(void);
+private:
+    enum class found_t { none, identifier, integer, floating, string, comment };
+
+    found_t     status = found_t::none;
+    token_type  type = T_empty;
+    std::string tok;
+};
+
+bool is_special_char(char);
+bool is_keyword(std::string);
+// Tokens that may appear in an operand or property value: literals and
+// identifiers (is_value_token), parentheses, and arithmetic operators.
+bool is_value_token(std::string);
+bool is_expression_token(std::string);
+
+void raise_syntax_error(Token, const debug_state_t&);
+// Returns the location of the next token, given the state before it is read
+// (tokens never start with whitespace, which is read as its own empty token).
+source_location_t get_source_location(const debug_state_t&);
 
 }   // qes
 
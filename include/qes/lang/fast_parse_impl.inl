@@ -12,4 +12,88 @@ get_literal_val(std::string type, std::string val) {
     else                        return val;
 }
 
+inline status_t
+parse_token(status_t status, std::string type, std::string val, parse_state_t& p_st) {
+    if (status == status_t::awaiting_token) {
+        return parse_awaiting_token(type, val, p_st);
+    } else if (status == status_t::in_instruction) {
+        return parse_in_instruction(type, val, p_st);
+    } else if (status == status_t::awaiting_modifier) {
+        return parse_awaiting_modifier(type, p_st);
+    } else if (status == status_t::in_annotation) {
+        return parse_in_annotation(type, val, p_st);
+    } else if (status == status_t::in_property) {
+        return parse_in_property(type, val, p_st);
+    } else if (status == status_t::in_label) {
+        return parse_in_label(type, val, p_st);
+    } else if (status == status_t::in_repeat) {
+        return parse_in_repeat(type, val, p_st);
+    } else if (status == status_t::in_definition) {
+        return parse_in_definition(type, val, p_st);
+    } else if (status == status_t::in_include) {
+        return parse_in_include(type, val, p_st);
+    }
+    return status;
+}
+
+inline read_phases_t
+get_read_phases(io_stats_t* stats) {
+    read_phases_t phases;
+    QES_IF_PROFILE(
+        if (stats != nullptr) {
+            phases.tokenize = &stats->get("tokenize");
+            phases.state_machine = &stats->get("state_machine");
+            phases.repeat_expansion = &stats->get("repeat_expansion");
+        }
+    )
+    return phases;
+}
+
+inline parse_scope_t
+parse_scope_t::nested() const {
+    parse_scope_t s(*this);
+    s.allow_definitions = false;
+    return s;
+}
+
+template <class PROGRAM> inline void
+reserve_more(PROGRAM& prog, size_t n) {
+    if (prog.size() + n > prog.capacity()) prog.reserve(std::max(prog.size() + n, 2*prog.capacity()));
+}
+
+inline bool
+is_special_char(char c) {
+    return c == ',' || c == ':' || c == ';' || c == '(' || c == ')'
+        || c == '{' || c == '}' || c == '@'
+        || c == '+' || c == '-' || c == '*' || c == '/' || c == '%';
+}
+
+inline bool
+is_value_token(std::string type) {
+    return type == "I_LITERAL" || type == "F_LITERAL" || type == "S_LITERAL" || type == "IDENTIFIER";
+}
+
+inline bool
+is_expression_token(std::string type) {
+    return is_value_token(type) || type == "(" || type == ")"
+        || type == "+" || type == "-" || type == "*" || type == "/" || type == "%";
+}
+
+inline bool
+is_keyword(std::string tok) {
+    return tok == "repeat" || tok == "annotation" || tok == "property" || tok == "def" || tok == "include";
+}
+
+inline void
+raise_syntax_error(Token tok, const debug_state_t& st) {
+    std::cerr << "[ qes ] found invalid token \"" << std::get<1>(tok) << "\" of type "
+        << std::get<0>(tok) << " at " << st << std::endl;
+    exit(1);
+}
+
+inline source_location_t
+get_source_location(const debug_state_t& st) {
+    return { st.line+1, st.col+1, 0 };
+}
+
 }   // qes
@@ -0,0 +1,42 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_FOOTPRINT_h
+#define QES_FOOTPRINT_h
+
+#include "qes/lang/instruction.h"
+
+#include <iostream>
+
+#include <stddef.h>
+
+namespace qes {
+
+// Estimated heap usage of a program, in bytes, broken down by what the memory
+// is used for. These are the bytes requested from the allocator (allocator
+// overheads are not included). Interned annotation and property names (see
+// qes/lang/registry.h) are shared, and so are not counted.
+struct memory_footprint_t {
+    size_t instructions = 0;    // The Instruction objects themselves.
+    size_t names = 0;
+    size_t operands = 0;
+    size_t annotations = 0;
+    size_t properties = 0;
+
+    size_t total(void) const;
+
+    memory_footprint_t& operator+=(const memory_footprint_t&);
+};
+
+template <class T, class U> memory_footprint_t memory_footprint(const Instruction<T, U>&);
+template <class T, class U> memory_footprint_t memory_footprint(const Program<T, U>&);
+
+std::ostream& operator<<(std::ostream&, const memory_footprint_t&);
+
+}   // qes
+
+#include "footprint.inl"
+
+#endif  // QES_FOOTPRINT_h
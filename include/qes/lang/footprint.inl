@@ -0,0 +1,77 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+inline size_t
+memory_footprint_t::total() const {
+    return instructions + names + operands + annotations + properties;
+}
+
+inline memory_footprint_t&
+memory_footprint_t::operator+=(const memory_footprint_t& other) {
+    instructions += other.instructions;
+    names += other.names;
+    operands += other.operands;
+    annotations += other.annotations;
+    properties += other.properties;
+    return *this;
+}
+
+// Heap bytes owned by a value (not including the value itself).
+template <class T> inline size_t
+heap_bytes(const T&) {
+    return 0;
+}
+
+inline size_t
+heap_bytes(const std::string& s) {
+    // Short strings are stored inline.
+    const char* p = s.data();
+    const char* obj = reinterpret_cast<const char*>(&s);
+    if (p >= obj && p < obj + sizeof(s)) return 0;
+    return s.capacity() + 1;
+}
+
+template <class... Ts> inline size_t
+heap_bytes(const std::variant<Ts...>& v) {
+    return std::visit([] (const auto& x) { return heap_bytes(x); }, v);
+}
+
+template <class T, class U> memory_footprint_t
+memory_footprint(const Instruction<T, U>& inst) {
+    memory_footprint_t f;
+    f.names = heap_bytes(inst.name);
+
+    f.operands = inst.operands.capacity() * sizeof(T);
+    for (const T& x : inst.operands) f.operands += heap_bytes(x);
+
+    f.annotations = inst.annotations.get_heap_bytes();
+
+    f.properties = inst.property_keys.get_heap_bytes() + inst.property_values.capacity() * sizeof(U);
+    for (const U& v : inst.property_values) f.properties += heap_bytes(v);
+    return f;
+}
+
+template <class T, class U> memory_footprint_t
+memory_footprint(const Program<T, U>& program) {
+    memory_footprint_t f;
+    f.instructions = program.capacity() * sizeof(Instruction<T, U>);
+    for (const auto& inst : program) f += memory_footprint(inst);
+    return f;
+}
+
+inline std::ostream&
+operator<<(std::ostream& out, const memory_footprint_t& f) {
+    out << "instructions: " << f.instructions
+        << ", names: " << f.names
+        << ", operands: " << f.operands
+        << ", annotations: " << f.annotations
+        << ", properties: " << f.properties
+        << ", total: " << f.total();
+    return out;
+}
+
+}   // qes
@@ -0,0 +1,75 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_INCREMENTAL_PARSE_h
+#define QES_INCREMENTAL_PARSE_h
+
+#include "qes/lang/block.h"
+#include "qes/lang/fast_parse_impl.h"
+
+#include <functional>
+
+namespace qes {
+
+// IncrementalParser is a push-mode version of fast_read_program. Instead of
+// pulling characters out of a std::istream (and recursing for every repeat
+// block), the caller pushes chunks of arbitrary size into feed(). All state,
+// including a partially read token, lives in the object, so a chunk boundary
+// may fall anywhere in the input.
+//
+// Instructions are completed as soon as their ";" arrives (or, inside a repeat
+// block, when the "}" of the outermost block arrives). If a callback is given,
+// it is called on each completed instruction. Otherwise, completed instructions
+// are buffered until they are retrieved with take().
+class IncrementalParser {
+public:
+    typedef std::function<void(Instruction<>&&)> callback_t;
+
+    IncrementalParser(void);
+    IncrementalParser(callback_t);
+
+    void    feed(const char*, size_t);
+    void    feed(std::string);
+    // Signals the end of the input. Any pending token is flushed, and it is an
+    // error if the input ends inside an instruction or a repeat block.
+    void    finish(void);
+
+    // Moves out all completed instructions that have not been taken yet.
+    Program<>   take(void);
+    size_t      get_number_of_ready_instructions(void) const;
+
+    debug_state_t get_debug_state(void) const;
+private:
+    void    consume(char);
+    void    end_token(void);
+    void    recv_token(token_type, std::string);
+    void    flush_top_level(void);
+
+    callback_t  callback;
+    Program<>   ready;
+
+    // The tokenizer keeps a partially read token between chunks.
+    Tokenizer   tokenizer;
+    // Parser state. There is one parse_state_t per open block, and the first
+    // entry is the top-level program.
+    status_t                    status;
+    std::vector<parse_state_t>  block_stack;
+    // Blocks with a loop variable and subroutine bodies (and any blocks within
+    // them) are kept compressed until the outermost such block ends, and then
+    // expanded (or defined). compressed_stack has one entry per open block in
+    // this region. There is one scope per open block.
+    std::vector<block_t>        compressed_stack;
+    std::vector<parse_scope_t>  scopes;
+    subroutine_table_t          subroutines;
+    bool                        in_definition;
+
+    debug_state_t   st;
+};
+
+}   // qes
+
+#include "incremental_parse.inl"
+
+#endif  // QES_INCREMENTAL_PARSE_h
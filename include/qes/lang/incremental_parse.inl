@@ -0,0 +1,30 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+inline void
+IncrementalParser::feed(std::string s) {
+    feed(s.data(), s.size());
+}
+
+inline Program<>
+IncrementalParser::take() {
+    Program<> out = std::move(ready);
+    ready.clear();
+    return out;
+}
+
+inline size_t
+IncrementalParser::get_number_of_ready_instructions() const {
+    return ready.size();
+}
+
+inline debug_state_t
+IncrementalParser::get_debug_state() const {
+    return st;
+}
+
+}   // qes
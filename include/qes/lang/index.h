@@ -0,0 +1,79 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_INDEX_h
+#define QES_INDEX_h
+
+#include "qes/lang/block.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+namespace qes {
+
+// An index_entry_t is a checkpoint into a .qes file: the top-level statement
+// starting at `offset` (at `line`:`col`) expands to the instructions starting at
+// instruction `first` of the program. If the statement is a repeat block,
+// then `period` is the number of instructions in one iteration, and otherwise
+// period = repeat_count = 1.
+struct index_entry_t {
+    uint64_t    offset;
+    uint64_t    line;
+    uint64_t    col;
+    uint64_t    first;
+    uint64_t    period;
+    uint64_t    repeat_count;
+};
+
+// instruction_index_t maps instruction numbers (of the expanded program) to
+// checkpoints. There is a checkpoint for every top-level repeat block, and at
+// least one every `stride` instructions otherwise, so read_range parses at most
+// `stride` instructions that it does not return.
+struct instruction_index_t {
+    uint64_t    n_instructions = 0;
+    // The size and modification time of the indexed file. Used to check if
+    // the sidecar is stale.
+    uint64_t    file_size = 0;
+    int64_t     file_mtime = 0;
+
+    std::vector<index_entry_t>  entries;
+    // The positions of the subroutine definitions, which read_range reads
+    // before the checkpoint (only offset, line, and col are used).
+    std::vector<index_entry_t>  definitions;
+
+    // Returns the last checkpoint at or before instruction i, or nullptr if
+    // there is none.
+    const index_entry_t* find(uint64_t i) const;
+};
+
+const uint64_t QES_INDEX_DEFAULT_STRIDE = 4096;
+
+instruction_index_t build_index(std::istream&, uint64_t stride=QES_INDEX_DEFAULT_STRIDE);
+
+// The sidecar index of "prog.qes" is "prog.qes.qidx".
+std::string get_index_file(std::string file);
+
+void    write_index(std::ostream&, const instruction_index_t&);
+// Returns false if the stream is not a valid index.
+bool    read_index(std::istream&, instruction_index_t&);
+
+// Loads the sidecar index of the file if it is up to date. Otherwise, the index
+// is built and the sidecar is (re)written.
+instruction_index_t load_index(std::string file);
+
+// Returns instructions [begin, end) of the expanded program in the file. Only
+// the statements containing these instructions are parsed.
+Program<>   read_range(std::string file, uint64_t begin, uint64_t end);
+Program<>   read_range(std::string file, uint64_t begin, uint64_t end, const instruction_index_t&);
+
+}   // qes
+
+#include "index.inl"
+
+#endif  // QES_INDEX_h
@@ -0,0 +1,26 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+inline const index_entry_t*
+instruction_index_t::find(uint64_t i) const {
+    auto it = std::upper_bound(entries.begin(), entries.end(), i,
+                    [] (uint64_t i, const index_entry_t& e) { return i < e.first; });
+    if (it == entries.begin()) return nullptr;
+    return &(*(it-1));
+}
+
+inline std::string
+get_index_file(std::string file) {
+    return file + ".qidx";
+}
+
+inline Program<>
+read_range(std::string file, uint64_t begin, uint64_t end) {
+    return read_range(file, begin, end, load_index(file));
+}
+
+}   // qes
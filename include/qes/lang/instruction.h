@@ -6,40 +6,60 @@
 #ifndef QES_INSTRUCTION_h
 #define QES_INSTRUCTION_h
 
+#include "qes/lang/registry.h"
+#include "qes/lang/value.h"
+
+#include <functional>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <set>
 #include <string>
-#include <variant>
 #include <vector>
 
 #include <stdint.h>
 
 namespace qes {
 
+struct memory_footprint_t;
+
 typedef std::string annotation_t;
-typedef std::variant<int64_t, double, std::string> any_t;
+typedef value_t any_t;
 
 // Instruction is the basic representation of any command in Qasl.
 //
 // It is templated (with default arguments) to represent any operand or
 // property of the instruction, so it is extensible to custom instructions.
-template <class OPERAND=any_t, class PROPERTY=any_t>
+//
+// ALLOC is the allocator of the name, operands, and property values (the ids
+// of annotations and property keys are stored inline, and only allocate if
+// there are more than 64 of them). See pmr::Instruction below.
+template <class OPERAND=any_t, class PROPERTY=any_t, template <class> class ALLOC=std::allocator>
 class Instruction {
 public:
+    typedef ALLOC<char> allocator_type;
+
     Instruction(void) = default;
-    Instruction(std::string, std::vector<OPERAND>);
+    explicit Instruction(const allocator_type&);
+    Instruction(std::string, std::vector<OPERAND>, const allocator_type& =allocator_type());
     Instruction(const Instruction&) = default;
     Instruction(Instruction&&) = default;
+    Instruction(const Instruction&, const allocator_type&);
+    Instruction(Instruction&&, const allocator_type&);
+    // Copies an instruction that uses a different allocator.
+    template <template <class> class B> Instruction(const Instruction<OPERAND, PROPERTY, B>&,
+                                                    const allocator_type& =allocator_type());
 
-    template <class T>      Instruction(std::string, std::vector<T>);
-    template <class ITER>   Instruction(std::string, ITER begin, ITER end);
+    template <class T>      Instruction(std::string, std::vector<T>, const allocator_type& =allocator_type());
+    template <class ITER>   Instruction(std::string, ITER begin, ITER end, const allocator_type& =allocator_type());
 
     Instruction& operator=(const Instruction&);
+    Instruction& operator=(Instruction&&) = default;
 
     bool operator==(const Instruction&) const;
 
     // This function gets an operand, assuming the value is T. If it is not,
-    // then std::variant will throw an error.
+    // then std::bad_variant_access is thrown.
     OPERAND              get(size_t) const;
     template <class T> T get(size_t) const;
 
@@ -52,6 +72,31 @@ public:
 
     PROPERTY             get_property(std::string) const;
     template <class T> T get_property(std::string) const;
+
+    // These take handles from qes/lang/registry.h, and take O(1) time if the
+    // handle's id is below 64.
+    void    put(annotation_handle_t);
+    void    put(property_handle_t, PROPERTY);
+
+    bool    has_annotation(annotation_handle_t) const;
+    bool    has_property(property_handle_t) const;
+
+    PROPERTY             get_property(property_handle_t) const;
+    template <class T> T get_property(property_handle_t) const;
+
+    // True if both instructions have the same annotations and properties.
+    bool    has_same_modifiers(const Instruction&) const;
+
+    // Calls f(annotation_handle_t) on each annotation, and f(property_handle_t,
+    // const PROPERTY&) on each property, in order of id.
+    template <class FUNC> void for_each_annotation(FUNC) const;
+    template <class FUNC> void for_each_property(FUNC) const;
+
+    // Calls f on each operand and then each property value (in order of key
+    // id). update_values may modify the values in place.
+    template <class FUNC> void for_each_value(FUNC) const;
+    template <class FUNC> void update_values(FUNC);
+
     // Merges the operands of two instructions together.
     void    join(const Instruction&);
 
@@ -59,34 +104,73 @@ public:
 
     std::string             get_name(void) const;
     std::vector<OPERAND>    get_operands(void) const;
+    // These return the annotations and properties by name (and so are slower
+    // than the handle-based functions).
     std::set<annotation_t>  get_annotations(void) const;
 
     size_t get_number_of_operands(void) const;
 
     std::map<std::string, PROPERTY> get_property_map(void) const;
-private:
-    std::string             name;
-    std::vector<OPERAND>    operands;
 
-    std::set<annotation_t>          annotations;
-    std::map<std::string, PROPERTY> property_map;
+    template <class, class, template <class> class> friend class Instruction;
+    template <class T, class U, template <class> class A> friend size_t hash_inst(const Instruction<T, U, A>&);
+    template <class T, class U> friend memory_footprint_t memory_footprint(const Instruction<T, U>&);
+private:
+    std::basic_string<char, std::char_traits<char>, ALLOC<char>>    name;
+    std::vector<OPERAND, ALLOC<OPERAND>>                            operands;
+
+    // Annotations and property keys are stored by their interned ids. Property
+    // values are ordered by key id, so the value of a key is at the rank of its
+    // id in property_keys.
+    id_set_t                                annotations;
+    id_set_t                                property_keys;
+    std::vector<PROPERTY, ALLOC<PROPERTY>>  property_values;
 };
 
+// Hashes the name, operands, annotations, and properties of an instruction.
+// Equal instructions (by operator==) have equal hashes.
+template <class T, class U, template <class> class A>
+size_t hash_inst(const Instruction<T, U, A>&);
+
 // Prints the instruction as it would appear in Qasl. If print_inline = false,
 // then newlines are used for readability.
-template <class T, class U>
-std::string print_inst(const Instruction<T, U>&, bool print_inline=true);
+template <class T, class U, template <class> class A>
+std::string print_inst(const Instruction<T, U, A>&, bool print_inline=true);
 
 template <class OPERAND=any_t, class PROPERTY=any_t>
 using Program=std::vector<Instruction<OPERAND, PROPERTY>>;
 
+// Instructions and programs whose memory comes from a std::pmr::memory_resource
+// (which is passed to the constructors, or to the program's constructor, as
+// pmr::Program passes its resource on to its instructions). For example, a
+// whole program can be read into one std::pmr::monotonic_buffer_resource, and
+// then freed at once.
+namespace pmr {
+
+template <class OPERAND=any_t, class PROPERTY=any_t>
+using Instruction=qes::Instruction<OPERAND, PROPERTY, std::pmr::polymorphic_allocator>;
+
+template <class OPERAND=any_t, class PROPERTY=any_t>
+using Program=std::pmr::vector<Instruction<OPERAND, PROPERTY>>;
+
+}   // pmr
+
 // This function is never going to print inline. Most useful to dump a Qasl
 // program to a file.
-template <class T, class U>
-std::string print_prog(const Program<T, U>&);
+template <class T, class U, template <class> class A, class V>
+std::string print_prog(const std::vector<Instruction<T, U, A>, V>&);
 
 }   // qes
 
+namespace std {
+
+template <class T, class U, template <class> class A>
+struct hash<qes::Instruction<T, U, A>> {
+    size_t operator()(const qes::Instruction<T, U, A>& inst) const { return qes::hash_inst(inst); }
+};
+
+}   // std
+
 #include "instruction.inl"
 
 #endif  // QES_INSTRUCTION_h
@@ -5,33 +5,80 @@
 
 #include <iomanip>
 #include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
 
 namespace qes {
 
-template <class T, class U>
-Instruction<T, U>::Instruction(std::string name, std::vector<T> operands)
-    :name(name),
-    operands(operands),
+template <class T, class U, template <class> class A>
+Instruction<T, U, A>::Instruction(const allocator_type& alloc)
+    :name(alloc),
+    operands(alloc),
     annotations(),
-    property_map()
+    property_keys(),
+    property_values(alloc)
 {}
 
-template <class T, class U>
+template <class T, class U, template <class> class A>
+Instruction<T, U, A>::Instruction(std::string name, std::vector<T> operands, const allocator_type& alloc)
+    :name(name.data(), name.size(), alloc),
+    operands(operands.begin(), operands.end(), alloc),
+    annotations(),
+    property_keys(),
+    property_values(alloc)
+{}
+
+template <class T, class U, template <class> class A>
+Instruction<T, U, A>::Instruction(const Instruction& other, const allocator_type& alloc)
+    :name(other.name, alloc),
+    operands(other.operands, alloc),
+    annotations(other.annotations),
+    property_keys(other.property_keys),
+    property_values(other.property_values, alloc)
+{}
+
+template <class T, class U, template <class> class A>
+Instruction<T, U, A>::Instruction(Instruction&& other, const allocator_type& alloc)
+    :name(std::move(other.name), alloc),
+    operands(std::move(other.operands), alloc),
+    annotations(std::move(other.annotations)),
+    property_keys(std::move(other.property_keys)),
+    property_values(std::move(other.property_values), alloc)
+{}
+
+template <class T, class U, template <class> class A>
+template <template <class> class B>
+Instruction<T, U, A>::Instruction(const Instruction<T, U, B>& other, const allocator_type& alloc)
+    :name(other.name.data(), other.name.size(), alloc),
+    operands(other.operands.begin(), other.operands.end(), alloc),
+    annotations(other.annotations),
+    property_keys(other.property_keys),
+    property_values(other.property_values.begin(), other.property_values.end(), alloc)
+{}
+
+template <class T, class U, template <class> class A>
 template <class X>
-Instruction<T, U>::Instruction(std::string name, std::vector<X> _operands)
-    :name(name),
-    operands(_operands.size())
+Instruction<T, U, A>::Instruction(std::string name, std::vector<X> _operands, const allocator_type& alloc)
+    :name(name.data(), name.size(), alloc),
+    operands(_operands.size(), alloc),
+    annotations(),
+    property_keys(),
+    property_values(alloc)
 {
     for (size_t i = 0; i < _operands.size(); i++) {
         operands[i] = _operands[i];
     }
 }
 
-template <class T, class U>
+template <class T, class U, template <class> class A>
 template <class ITER>
-Instruction<T, U>::Instruction(std::string name, ITER begin, ITER end)
-    :name(name),
-    operands()
+Instruction<T, U, A>::Instruction(std::string name, ITER begin, ITER end, const allocator_type& alloc)
+    :name(name.data(), name.size(), alloc),
+    operands(alloc),
+    annotations(),
+    property_keys(),
+    property_values(alloc)
 {
     for (auto it = begin; it != end; it++) {
         T op(*it);
@@ -39,97 +86,205 @@ Instruction<T, U>::Instruction(std::string name, ITER begin, ITER end)
     }
 }
 
-template <class T, class U> inline Instruction<T, U>&
-Instruction<T, U>::operator=(const Instruction<T, U>& other) {
+template <class T, class U, template <class> class A> inline Instruction<T, U, A>&
+Instruction<T, U, A>::operator=(const Instruction<T, U, A>& other) {
     name = other.name;
     operands = other.operands;
     annotations = other.annotations;
-    property_map = other.property_map;
+    property_keys = other.property_keys;
+    property_values = other.property_values;
     return *this;
 }
 
-template <class T, class U> inline T
-Instruction<T, U>::get(size_t k) const {
+template <class T, class U, template <class> class A> inline bool
+Instruction<T, U, A>::operator==(const Instruction<T, U, A>& other) const {
+    return name == other.name
+        && operands == other.operands
+        && has_same_modifiers(other);
+}
+
+template <class T, class U, template <class> class A> inline T
+Instruction<T, U, A>::get(size_t k) const {
     return operands.at(k);
 }
 
-template <class T, class U>
+template <class T, class U, template <class> class A>
+template <class X> inline X
+Instruction<T, U, A>::get(size_t k) const {
+    return qes::get<X>(operands.at(k));
+}
+
+template <class T, class U, template <class> class A> inline void
+Instruction<T, U, A>::put(std::string ann) {
+    put(get_annotation_handle(ann));
+}
+
+template <class T, class U, template <class> class A> inline void
+Instruction<T, U, A>::put(std::string p, U v) {
+    put(get_property_handle(p), v);
+}
+
+template <class T, class U, template <class> class A> inline bool
+Instruction<T, U, A>::has_annotation(std::string x) const {
+    annotation_handle_t h;
+    return find_annotation_handle(x, h) && has_annotation(h);
+}
+
+template <class T, class U, template <class> class A> inline bool
+Instruction<T, U, A>::has_property(std::string x) const {
+    property_handle_t h;
+    return find_property_handle(x, h) && has_property(h);
+}
+
+template <class T, class U, template <class> class A> inline U
+Instruction<T, U, A>::get_property(std::string x) const {
+    property_handle_t h;
+    if (!find_property_handle(x, h)) throw std::out_of_range("no property named " + x);
+    return get_property(h);
+}
+
+template <class T, class U, template <class> class A>
 template <class X> inline X
-Instruction<T, U>::get(size_t k) const {
-    return std::get<X>(operands.at(k));
+Instruction<T, U, A>::get_property(std::string x) const {
+    return qes::get<X>(get_property(x));
 }
 
-template <class T, class U> inline void
-Instruction<T, U>::put(std::string ann) {
-    annotations.insert(ann);
+template <class T, class U, template <class> class A> inline void
+Instruction<T, U, A>::put(annotation_handle_t h) {
+    annotations.insert(h.id);
 }
 
-template <class T, class U> inline void
-Instruction<T, U>::put(std::string p, U v) {
-    property_map[p] = v;
+template <class T, class U, template <class> class A> inline void
+Instruction<T, U, A>::put(property_handle_t h, U v) {
+    const size_t r = property_keys.rank(h.id);
+    if (property_keys.insert(h.id)) {
+        property_values.insert(property_values.begin() + r, std::move(v));
+    } else {
+        property_values[r] = std::move(v);
+    }
 }
 
-template <class T, class U> inline bool
-Instruction<T, U>::has_annotation(std::string x) const {
-    return annotations.count(x);
+template <class T, class U, template <class> class A> inline bool
+Instruction<T, U, A>::has_annotation(annotation_handle_t h) const {
+    return annotations.contains(h.id);
 }
 
-template <class T, class U> inline bool
-Instruction<T, U>::has_property(std::string x) const {
-    return property_map.count(x);
+template <class T, class U, template <class> class A> inline bool
+Instruction<T, U, A>::has_property(property_handle_t h) const {
+    return property_keys.contains(h.id);
 }
 
-template <class T, class U> inline U
-Instruction<T, U>::get_property(std::string x) const {
-    return property_map.at(x);
+template <class T, class U, template <class> class A> inline U
+Instruction<T, U, A>::get_property(property_handle_t h) const {
+    if (!property_keys.contains(h.id)) {
+        throw std::out_of_range("no property named " + get_property_name(h));
+    }
+    return property_values[property_keys.rank(h.id)];
 }
 
-template <class T, class U>
+template <class T, class U, template <class> class A>
 template <class X> inline X
-Instruction<T, U>::get_property(std::string x) const {
-    return std::get<X>(property_map.at(x));
+Instruction<T, U, A>::get_property(property_handle_t h) const {
+    return qes::get<X>(get_property(h));
+}
+
+template <class T, class U, template <class> class A> inline bool
+Instruction<T, U, A>::has_same_modifiers(const Instruction<T, U, A>& other) const {
+    return annotations == other.annotations
+        && property_keys == other.property_keys
+        && property_values == other.property_values;
+}
+
+template <class T, class U, template <class> class A>
+template <class FUNC> inline void
+Instruction<T, U, A>::for_each_value(FUNC f) const {
+    for (const T& x : operands)         f(x);
+    for (const U& x : property_values)  f(x);
+}
+
+template <class T, class U, template <class> class A>
+template <class FUNC> inline void
+Instruction<T, U, A>::for_each_annotation(FUNC f) const {
+    annotations.for_each([&] (uint32_t id) { f(annotation_handle_t{id}); });
+}
+
+template <class T, class U, template <class> class A>
+template <class FUNC> inline void
+Instruction<T, U, A>::for_each_property(FUNC f) const {
+    size_t k = 0;
+    property_keys.for_each([&] (uint32_t id) { f(property_handle_t{id}, property_values[k++]); });
 }
 
-template <class T, class U> inline void
-Instruction<T, U>::join(const Instruction<T, U>& other) {
+template <class T, class U, template <class> class A>
+template <class FUNC> inline void
+Instruction<T, U, A>::update_values(FUNC f) {
+    for (T& x : operands)           f(x);
+    for (U& x : property_values)    f(x);
+}
+
+template <class T, class U, template <class> class A> inline void
+Instruction<T, U, A>::join(const Instruction<T, U, A>& other) {
     // If the names are not equal, exit.
-    if (name != other.get_name()) return;
+    if (name != other.name) return;
     // Otherwise, good to go.
     operands.insert(operands.end(), other.operands.cbegin(), other.operands.cend());
 }
 
-template <class T, class U> inline void
-Instruction<T, U>::set_operands(std::vector<T> arr) {
-    operands = std::move(arr);
+template <class T, class U, template <class> class A> inline void
+Instruction<T, U, A>::set_operands(std::vector<T> arr) {
+    if constexpr (std::is_same_v<decltype(operands), std::vector<T>>) {
+        operands = std::move(arr);
+    } else {
+        operands.assign(arr.begin(), arr.end());
+    }
 }
 
-template <class T, class U> inline std::string
-Instruction<T, U>::get_name() const {
-    return name;
+template <class T, class U, template <class> class A> inline std::string
+Instruction<T, U, A>::get_name() const {
+    return std::string(name.data(), name.size());
 }
 
-template <class T, class U> inline std::vector<T>
-Instruction<T, U>::get_operands() const {
-    return operands;
+template <class T, class U, template <class> class A> inline std::vector<T>
+Instruction<T, U, A>::get_operands() const {
+    return std::vector<T>(operands.begin(), operands.end());
 }
 
-template <class T, class U> inline std::set<annotation_t>
-Instruction<T, U>::get_annotations() const {
-    return annotations;
+template <class T, class U, template <class> class A> inline std::set<annotation_t>
+Instruction<T, U, A>::get_annotations() const {
+    std::set<annotation_t> out;
+    annotations.for_each([&] (uint32_t id) { out.insert(get_annotation_name({id})); });
+    return out;
 }
 
-template <class T, class U> inline size_t
-Instruction<T, U>::get_number_of_operands() const {
+template <class T, class U, template <class> class A> inline size_t
+Instruction<T, U, A>::get_number_of_operands() const {
     return operands.size();
 }
 
-template <class T, class U> inline std::map<std::string, U>
-Instruction<T, U>::get_property_map() const {
-    return property_map;
+template <class T, class U, template <class> class A> inline std::map<std::string, U>
+Instruction<T, U, A>::get_property_map() const {
+    std::map<std::string, U> out;
+    size_t i = 0;
+    property_keys.for_each([&] (uint32_t id) { out[get_property_name({id})] = property_values[i++]; });
+    return out;
+}
+
+template <class T, class U, template <class> class A> size_t
+hash_inst(const Instruction<T, U, A>& inst) {
+    // Same mixing as boost::hash_combine.
+    size_t h = std::hash<std::string_view>{}(std::string_view(inst.name.data(), inst.name.size()));
+    auto combine = [&] (size_t x) { h ^= x + 0x9e3779b9 + (h << 6) + (h >> 2); };
+
+    combine(inst.operands.size());
+    for (const T& op : inst.operands)               combine(std::hash<T>{}(op));
+    combine(inst.annotations.hash());
+    combine(inst.property_keys.hash());
+    for (const U& v : inst.property_values)         combine(std::hash<U>{}(v));
+    return h;
 }
 
-template <class T, class U> std::string
-print_inst(const Instruction<T, U>& inst, bool print_inline) {
+template <class T, class U, template <class> class A> std::string
+print_inst(const Instruction<T, U, A>& inst, bool print_inline) {
     const std::string whitespace = print_inline ? " " : "\n";
     std::ostringstream sout;
     // Dump annotations and properties first.
@@ -138,23 +293,23 @@ print_inst(const Instruction<T, U>& inst, bool print_inline) {
     }
     for (auto pair : inst.get_property_map()) {
         sout << "@property " << pair.first << " ";
-        std::visit([&] (auto x) { sout << x; }, pair.second);
+        qes::visit([&] (auto x) { print_value(sout, x); }, pair.second);
         sout << whitespace;
     }
     // Finally dump the instruction contents
     sout << std::left << std::setw(11) << inst.get_name() << " ";
     bool first = true;
-    for (U op : inst.get_operands()) {
+    for (const T& op : inst.get_operands()) {
         if (!first) sout << ",";
         first = false;
-        std::visit([&] (auto x) { sout << x; }, op);
+        qes::visit([&] (auto x) { print_value(sout, x); }, op);
     }
     sout << ";";
     return sout.str();
 }
 
-template <class T, class U> inline std::string
-print_prog(const Program<T, U>& program) {
+template <class T, class U, template <class> class A, class V> inline std::string
+print_prog(const std::vector<Instruction<T, U, A>, V>& program) {
     std::string out;
     for (size_t i = 0; i < program.size(); i++) {
         if (i > 0) out += "\n";
@@ -0,0 +1,91 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_INTERN_h
+#define QES_INTERN_h
+
+#include "qes/lang/fast_parse.h"
+#include "qes/lang/instruction.h"
+
+#include <deque>
+#include <unordered_map>
+
+namespace qes {
+
+// Unrolled repeat blocks produce many structurally identical instructions. An
+// InstructionPool hash-conses instructions: each distinct instruction is stored
+// once (with its hash precomputed), and callers hold InstructionHandles to the
+// shared, immutable body. Two handles from the same pool are equal if and only
+// if their instructions are equal, so comparisons and hashing are O(1).
+//
+// The pool owns all bodies, so handles are only valid while the pool is alive.
+template <class T, class U>
+struct interned_inst_t {
+    Instruction<T, U>   inst;
+    size_t              hash;
+};
+
+template <class T=any_t, class U=any_t>
+class InstructionHandle {
+public:
+    InstructionHandle(void) = default;
+    InstructionHandle(const interned_inst_t<T, U>*);
+
+    const Instruction<T, U>& operator*(void) const;
+    const Instruction<T, U>* operator->(void) const;
+
+    bool    operator==(const InstructionHandle&) const;
+    size_t  hash(void) const;
+private:
+    const interned_inst_t<T, U>* ptr = nullptr;
+};
+
+template <class T=any_t, class U=any_t>
+using InternedProgram=std::vector<InstructionHandle<T, U>>;
+
+template <class T=any_t, class U=any_t>
+class InstructionPool {
+public:
+    InstructionPool(void) = default;
+    InstructionPool(const InstructionPool&) = delete;
+
+    InstructionHandle<T, U> intern(const Instruction<T, U>&);
+    InstructionHandle<T, U> intern(Instruction<T, U>&&);
+
+    // Returns the number of distinct instructions in the pool.
+    size_t size(void) const;
+private:
+    InstructionHandle<T, U> intern(Instruction<T, U>&&, size_t hash);
+
+    // std::deque never moves its elements, so handles remain valid.
+    std::deque<interned_inst_t<T, U>> bodies;
+    std::unordered_multimap<size_t, const interned_inst_t<T, U>*> table;
+};
+
+template <class T, class U>
+InternedProgram<T, U>   intern_program(const Program<T, U>&, InstructionPool<T, U>&);
+template <class T, class U>
+Program<T, U>           flatten(const InternedProgram<T, U>&);
+
+// Interning version of fast_read_program. Repeat blocks are unrolled by
+// copying handles rather than instructions.
+InternedProgram<>   fast_read_interned_program(std::istream&, InstructionPool<>&);
+InternedProgram<>   read_interned_block(std::istream&, debug_state_t&, InstructionPool<>&,
+                                        const parse_scope_t* scope=nullptr);
+
+}   // qes
+
+namespace std {
+
+template <class T, class U>
+struct hash<qes::InstructionHandle<T, U>> {
+    size_t operator()(const qes::InstructionHandle<T, U>& h) const { return h.hash(); }
+};
+
+}   // std
+
+#include "intern.inl"
+
+#endif  // QES_INTERN_h
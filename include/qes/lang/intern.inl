@@ -0,0 +1,82 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+template <class T, class U>
+InstructionHandle<T, U>::InstructionHandle(const interned_inst_t<T, U>* p)
+    :ptr(p)
+{}
+
+template <class T, class U> inline const Instruction<T, U>&
+InstructionHandle<T, U>::operator*() const {
+    return ptr->inst;
+}
+
+template <class T, class U> inline const Instruction<T, U>*
+InstructionHandle<T, U>::operator->() const {
+    return &ptr->inst;
+}
+
+template <class T, class U> inline bool
+InstructionHandle<T, U>::operator==(const InstructionHandle<T, U>& other) const {
+    return ptr == other.ptr;
+}
+
+template <class T, class U> inline size_t
+InstructionHandle<T, U>::hash() const {
+    return ptr->hash;
+}
+
+template <class T, class U> inline InstructionHandle<T, U>
+InstructionPool<T, U>::intern(const Instruction<T, U>& inst) {
+    const size_t h = hash_inst(inst);
+    auto range = table.equal_range(h);
+    for (auto it = range.first; it != range.second; it++) {
+        if (it->second->inst == inst) return InstructionHandle<T, U>(it->second);
+    }
+    return intern(Instruction<T, U>(inst), h);
+}
+
+template <class T, class U> inline InstructionHandle<T, U>
+InstructionPool<T, U>::intern(Instruction<T, U>&& inst) {
+    const size_t h = hash_inst(inst);
+    auto range = table.equal_range(h);
+    for (auto it = range.first; it != range.second; it++) {
+        if (it->second->inst == inst) return InstructionHandle<T, U>(it->second);
+    }
+    return intern(std::move(inst), h);
+}
+
+template <class T, class U> inline InstructionHandle<T, U>
+InstructionPool<T, U>::intern(Instruction<T, U>&& inst, size_t h) {
+    bodies.push_back({std::move(inst), h});
+    const interned_inst_t<T, U>* p = &bodies.back();
+    table.emplace(h, p);
+    return InstructionHandle<T, U>(p);
+}
+
+template <class T, class U> inline size_t
+InstructionPool<T, U>::size() const {
+    return bodies.size();
+}
+
+template <class T, class U> InternedProgram<T, U>
+intern_program(const Program<T, U>& program, InstructionPool<T, U>& pool) {
+    InternedProgram<T, U> out;
+    out.reserve(program.size());
+    for (const auto& inst : program) out.push_back(pool.intern(inst));
+    return out;
+}
+
+template <class T, class U> Program<T, U>
+flatten(const InternedProgram<T, U>& program) {
+    Program<T, U> out;
+    out.reserve(program.size());
+    for (const auto& h : program) out.push_back(*h);
+    return out;
+}
+
+}   // qes
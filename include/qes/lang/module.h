@@ -0,0 +1,67 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_MODULE_h
+#define QES_MODULE_h
+
+#include "qes/lang/block.h"
+
+#include <memory>
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace qes {
+
+// A module is a file that other programs include:
+//      include "preamble.qes";
+// Each module is parsed once per process and kept in a (thread-safe) cache,
+// keyed by its canonical path and modification time. A cached module is read
+// again if it, or any module it includes (directly or not), was modified.
+// Includes refer to the cached module rather than copying it: an include is
+// read as a call to the module's body (see block_t), and the subroutines
+// defined by the module become visible to the including program.
+//
+// Modules are parsed on their own, so they cannot use the loop variables or
+// parameters of the block that includes them.
+struct module_t {
+    std::string path;   // The canonical path.
+    // The statements of the module, as a subroutine without parameters.
+    std::shared_ptr<const subroutine_t> body;
+    // The subroutines defined by the module (including those of its includes).
+    subroutine_table_t                  subroutines;
+};
+
+// Returns the module at the given path (see resolve_include_path), reading it
+// if it is not in the cache, or if it or its includes were modified since it
+// was read. Exits if the module cannot be read or is part of an include cycle.
+std::shared_ptr<const module_t> load_module(const std::string&);
+
+void    clear_module_cache(void);
+size_t  get_module_cache_size(void);
+
+// Returns the canonical path of an included file. Relative paths are resolved
+// against the directory of the file being read on this thread (see
+// IncludeGuard), or the working directory if there is none. Exits if the file
+// does not exist.
+std::string resolve_include_path(const std::string&);
+
+// Returns the number of modules included on this thread so far.
+uint64_t    get_number_of_includes(void);
+
+// Marks a file as being read on this thread while the guard is alive. Relative
+// includes are resolved against the file's directory, and an include of any
+// file being read exits with an include cycle error.
+class IncludeGuard {
+public:
+    IncludeGuard(const std::string& file);
+    IncludeGuard(const IncludeGuard&) = delete;
+    ~IncludeGuard(void);
+};
+
+}   // qes
+
+#endif  // QES_MODULE_h
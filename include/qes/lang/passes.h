@@ -0,0 +1,97 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_PASSES_h
+#define QES_PASSES_h
+
+#include "qes/lang/instruction.h"
+
+#include <map>
+#include <memory>
+#include <set>
+
+namespace qes {
+
+// Passes are per-instruction rewrites over a program. A PassManager runs a
+// pipeline of passes in a single, in-place traversal: each instruction is given
+// to each pass in order, along with the last instruction of the (already
+// rewritten) output. A pass may:
+//      keep:   let the instruction through (possibly after modifying it),
+//      drop:   discard the instruction (e.g. after merging it into prev),
+//      cancel: discard both the instruction and prev.
+// As all passes look at the same output, rewrites cascade (e.g. "x 0; h 0;
+// h 0; x 0;" is cancelled entirely), and the traversal is linear time.
+enum class pass_action_t { keep, drop, cancel };
+
+template <class T=any_t, class U=any_t>
+class Pass {
+public:
+    virtual ~Pass(void) = default;
+
+    // `prev` is the last instruction in the output, or nullptr if the output is
+    // empty. Passes must not hold any state across calls (so that they can be
+    // run on multiple ranges in parallel), and any change to `inst` before
+    // returning keep must be idempotent.
+    virtual pass_action_t apply(Instruction<T, U>& inst, Instruction<T, U>* prev) const =0;
+};
+
+// Merges an instruction into the previous one (with Instruction::join) if they
+// have the same name, annotations, and properties. If `names` is nonempty, only
+// instructions with those names are merged.
+template <class T=any_t, class U=any_t>
+class JoinPass : public Pass<T, U> {
+public:
+    JoinPass(std::set<std::string> names={});
+
+    pass_action_t apply(Instruction<T, U>&, Instruction<T, U>*) const override;
+private:
+    std::set<std::string> names;
+};
+
+// Cancels an instruction with the previous one if the previous instruction is
+// its inverse: the names are inverses (see the constructor), and both have the
+// same operands, annotations, and properties. As an instruction with multiple
+// operands applies its gate to each operand (or operand group), instructions
+// whose operands are not all distinct are never cancelled.
+template <class T=any_t, class U=any_t>
+class InverseCancellationPass : public Pass<T, U> {
+public:
+    // By default, h, x, y, z, cx, cz, and swap are self-inverse, and s/sdg and
+    // t/tdg are inverse pairs.
+    InverseCancellationPass(void);
+    InverseCancellationPass(std::map<std::string, std::string> inverse_of);
+
+    pass_action_t apply(Instruction<T, U>&, Instruction<T, U>*) const override;
+private:
+    std::map<std::string, std::string> inverse_of;
+};
+
+template <class T=any_t, class U=any_t>
+class PassManager {
+public:
+    void    add(std::shared_ptr<Pass<T, U>>);
+
+    void    run(Program<T, U>&) const;
+    // Runs the pipeline on n_threads ranges of the program in parallel, and
+    // then stitches the ranges together by running the pipeline across each
+    // boundary. Every rewrite is still one the passes allowed, but the result
+    // only matches run() if the pipeline is confluent (the order of rewrites
+    // does not matter). JoinPass and InverseCancellationPass each are, but
+    // together they are not: e.g. a join may create an instruction with
+    // repeated operands, which can no longer be cancelled.
+    void    run_parallel(Program<T, U>&, size_t n_threads=0) const;
+private:
+    // Runs the pipeline on program[r], where the output so far is [begin, w).
+    // Returns true if every pass kept the instruction.
+    bool    feed(Program<T, U>&, size_t begin, size_t& w, size_t r) const;
+
+    std::vector<std::shared_ptr<Pass<T, U>>> passes;
+};
+
+}   // qes
+
+#include "passes.inl"
+
+#endif  // QES_PASSES_h
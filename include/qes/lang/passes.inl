@@ -0,0 +1,132 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include <algorithm>
+#include <thread>
+
+namespace qes {
+
+template <class T, class U>
+JoinPass<T, U>::JoinPass(std::set<std::string> names)
+    :names(names)
+{}
+
+template <class T, class U> pass_action_t
+JoinPass<T, U>::apply(Instruction<T, U>& inst, Instruction<T, U>* prev) const {
+    if (prev == nullptr) return pass_action_t::keep;
+    const std::string name = inst.get_name();
+    if (name != prev->get_name()) return pass_action_t::keep;
+    if (!names.empty() && !names.count(name)) return pass_action_t::keep;
+    if (!inst.has_same_modifiers(*prev)) return pass_action_t::keep;
+    prev->join(inst);
+    return pass_action_t::drop;
+}
+
+template <class T, class U>
+InverseCancellationPass<T, U>::InverseCancellationPass()
+    :inverse_of{
+        {"h", "h"}, {"x", "x"}, {"y", "y"}, {"z", "z"},
+        {"cx", "cx"}, {"cz", "cz"}, {"swap", "swap"},
+        {"s", "sdg"}, {"sdg", "s"},
+        {"t", "tdg"}, {"tdg", "t"}
+    }
+{}
+
+template <class T, class U>
+InverseCancellationPass<T, U>::InverseCancellationPass(std::map<std::string, std::string> inv)
+    :inverse_of(inv)
+{}
+
+template <class T, class U> pass_action_t
+InverseCancellationPass<T, U>::apply(Instruction<T, U>& inst, Instruction<T, U>* prev) const {
+    if (prev == nullptr) return pass_action_t::keep;
+    auto it = inverse_of.find(inst.get_name());
+    if (it == inverse_of.end() || it->second != prev->get_name()) return pass_action_t::keep;
+
+    std::vector<T> operands = inst.get_operands();
+    if (operands != prev->get_operands()) return pass_action_t::keep;
+    // Only cancel if no operand is repeated, as otherwise the gates within
+    // the instruction may not commute.
+    for (size_t i = 0; i < operands.size(); i++) {
+        for (size_t j = i+1; j < operands.size(); j++) {
+            if (operands[i] == operands[j]) return pass_action_t::keep;
+        }
+    }
+    if (!inst.has_same_modifiers(*prev)) return pass_action_t::keep;
+    return pass_action_t::cancel;
+}
+
+template <class T, class U> inline void
+PassManager<T, U>::add(std::shared_ptr<Pass<T, U>> p) {
+    passes.push_back(p);
+}
+
+template <class T, class U> inline bool
+PassManager<T, U>::feed(Program<T, U>& program, size_t begin, size_t& w, size_t r) const {
+    Instruction<T, U>& inst = program[r];
+    for (const auto& p : passes) {
+        Instruction<T, U>* prev = (w > begin) ? &program[w-1] : nullptr;
+        pass_action_t a = p->apply(inst, prev);
+        if (a == pass_action_t::drop) {
+            return false;
+        } else if (a == pass_action_t::cancel) {
+            w--;
+            return false;
+        }
+    }
+    if (w != r) program[w] = std::move(inst);
+    w++;
+    return true;
+}
+
+template <class T, class U> void
+PassManager<T, U>::run(Program<T, U>& program) const {
+    size_t w = 0;
+    for (size_t r = 0; r < program.size(); r++) feed(program, 0, w, r);
+    program.erase(program.begin() + w, program.end());
+}
+
+template <class T, class U> void
+PassManager<T, U>::run_parallel(Program<T, U>& program, size_t n_threads) const {
+    if (n_threads == 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::min(n_threads, program.size());
+    if (n_threads <= 1) {
+        run(program);
+        return;
+    }
+    // Run each range independently.
+    const size_t range_size = (program.size() + n_threads - 1) / n_threads;
+    std::vector<size_t> range_begin(n_threads), range_end(n_threads);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n_threads; i++) {
+        range_begin[i] = std::min(i*range_size, program.size());
+        threads.emplace_back([&, i] () {
+            const size_t b = range_begin[i],
+                         e = std::min(b + range_size, program.size());
+            size_t w = b;
+            for (size_t r = b; r < e; r++) feed(program, b, w, r);
+            range_end[i] = w;
+        });
+    }
+    for (auto& t : threads) t.join();
+    // Stitch the ranges together. The start of each range is fed through the
+    // pipeline again, now with the previous ranges as the output. Once an
+    // instruction is kept, the rest of the range sees the same `prev` as it
+    // did before, so it can be moved over as is.
+    size_t w = range_end[0];
+    for (size_t i = 1; i < n_threads; i++) {
+        size_t j = range_begin[i];
+        while (j < range_end[i]) {
+            if (feed(program, 0, w, j++)) break;
+        }
+        for (; j < range_end[i]; j++) {
+            if (w != j) program[w] = std::move(program[j]);
+            w++;
+        }
+    }
+    program.erase(program.begin() + w, program.end());
+}
+
+}   // qes
@@ -0,0 +1,66 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_PIPELINE_h
+#define QES_PIPELINE_h
+
+#include "qes/lang/incremental_parse.h"
+#include "qes/util/spsc_queue.h"
+
+#include <iostream>
+#include <memory>
+#include <thread>
+
+namespace qes {
+
+// PipelinedReader parses a program on a background thread and hands it to the
+// caller in batches of (up to) batch_size instructions, so that the caller can
+// start executing the program while the rest of it is parsed.
+//
+// Batches are passed through an SPSCQueue of max_batches batches. If the caller
+// falls behind, the parser blocks, so at most about max_batches*batch_size
+// instructions are buffered. The exception is a top-level repeat block, which
+// is expanded in full before any of it is passed on (see IncrementalParser).
+//
+//      PipelinedReader reader("prog.qes");
+//      Program<> batch;
+//      while (reader.pop(batch)) {
+//          for (const auto& inst : batch) simulate(inst);
+//      }
+class PipelinedReader {
+public:
+    // The file may be compressed (see qes/util/compression.h).
+    PipelinedReader(std::string file, size_t batch_size=1024, size_t max_batches=64);
+    // The stream must outlive the reader.
+    PipelinedReader(std::istream&, size_t batch_size=1024, size_t max_batches=64);
+    // Stops the parser if the program has not been fully read.
+    ~PipelinedReader(void);
+
+    // Blocks until the next batch is ready. Returns false once every batch has
+    // been returned.
+    bool    pop(Program<>&);
+    // Returns false if no batch is ready right now. Use is_finished() to check
+    // if more batches will come.
+    bool    try_pop(Program<>&);
+
+    bool    is_finished(void) const;
+    // The number of parsed batches that are waiting to be popped.
+    size_t  get_number_of_ready_batches(void) const;
+private:
+    void    run(void);
+
+    std::unique_ptr<std::istream>   owned_stream;
+    std::istream&                   fin;
+
+    const size_t        batch_size;
+    SPSCQueue<Program<>> queue;
+    std::thread         worker;
+};
+
+}   // qes
+
+#include "pipeline.inl"
+
+#endif  // QES_PIPELINE_h
@@ -0,0 +1,28 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+inline bool
+PipelinedReader::pop(Program<>& batch) {
+    return queue.pop(batch);
+}
+
+inline bool
+PipelinedReader::try_pop(Program<>& batch) {
+    return queue.try_pop(batch);
+}
+
+inline bool
+PipelinedReader::is_finished() const {
+    return queue.is_closed() && queue.size() == 0;
+}
+
+inline size_t
+PipelinedReader::get_number_of_ready_batches() const {
+    return queue.size();
+}
+
+}   // qes
@@ -0,0 +1,76 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_QUBIT_INDEX_h
+#define QES_QUBIT_INDEX_h
+
+#include "qes/lang/instruction.h"
+
+#include <span>
+#include <vector>
+
+#include <stdint.h>
+
+namespace qes {
+
+// QubitIndex maps each qubit (a non-negative integer operand) to the sorted
+// positions of the instructions that use it. It can be built while parsing
+// (see fast_read_program) and is then updated as instructions are appended:
+//
+//      QubitIndex qubits;
+//      Program<> program = fast_read_program(fin, qubits);
+//      for (uint64_t i : qubits.get(3)) { ... program[i] uses qubit 3 ... }
+//
+// The positions are stored in CSR form, with some slack after the positions of
+// each qubit so that appends take amortized O(1) time. When a qubit runs out of
+// slack, the arrays are rebuilt, and each qubit's slack is doubled. compact()
+// removes the slack.
+//
+// The arrays are dense in the qubits (i.e., sized by the largest qubit), so
+// the qubits that can be indexed are limited (see set_max_qubit).
+class QubitIndex {
+public:
+    // Indexes the instruction as the next position (i.e., size()).
+    void    add(const Instruction<>&);
+    // Indexes the instructions of the program from position size() onwards
+    // (i.e., those that were appended since the last update).
+    void    update(const Program<>&);
+
+    // Returns the positions of the instructions that use the qubit, in order.
+    // Takes O(1) time. The span is invalidated by add, update, and compact.
+    std::span<const uint64_t>   get(int64_t qubit) const;
+
+    void    compact(void);
+
+    // The number of instructions that have been indexed.
+    uint64_t    size(void) const;
+    // One more than the largest qubit.
+    size_t      get_number_of_qubits(void) const;
+private:
+    void    push(uint64_t qubit, uint64_t pos);
+    // Rebuilds the arrays, giving each qubit slack_factor times its number of
+    // positions.
+    void    rebuild(uint64_t slack_factor);
+
+    uint64_t n_instructions = 0;
+
+    // The positions of qubit q start at offsets[q], and there are counts[q] of
+    // them. The space before offsets[q+1] is slack.
+    std::vector<uint64_t>   offsets{0};
+    std::vector<uint64_t>   counts;
+    std::vector<uint64_t>   positions;
+};
+
+// The largest qubit that QubitIndex and asap_schedule (see
+// qes/lang/schedule.h) accept, as both allocate arrays indexed by qubit. The
+// default is 2^24 - 1.
+void    set_max_qubit(int64_t);
+int64_t get_max_qubit(void);
+// Exits if the qubit is larger than get_max_qubit().
+void    test_qubit_is_supported(int64_t);
+
+}   // qes
+
+#endif  // QES_QUBIT_INDEX_h
@@ -0,0 +1,100 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_QUERY_INDEX_h
+#define QES_QUERY_INDEX_h
+
+#include "qes/lang/instruction.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+
+namespace qes {
+
+enum class compare_t { eq, lt, le, gt, ge };
+
+// A condition on an instruction: it has an annotation, it has a property, or
+// it has a property whose value compares to the given value. Numbers (integers
+// and doubles) are compared by value, and strings lexicographically. A number
+// and a string never compare (so the condition is false).
+struct query_term_t {
+    enum class kind_t { annotation, property };
+
+    kind_t      kind;
+    std::string name;
+    bool        has_value = false;
+    compare_t   cmp = compare_t::eq;
+    any_t       value;
+};
+
+query_term_t    annotation_term(std::string);
+query_term_t    property_term(std::string);
+query_term_t    property_term(std::string, compare_t, any_t);
+
+// QueryIndex answers conjunctive queries over the annotations and properties
+// of a program:
+//
+//      QueryIndex index(program);
+//      std::vector<uint64_t> rows = index.query({ annotation_term("measured"),
+//                                      property_term("round", compare_t::ge, 10) });
+//
+// Each annotation has a posting list (the sorted positions of the instructions
+// with it). Each property has a posting list and a value index: the (value,
+// position) pairs of the instructions with it, sorted by value.
+//
+// A query finds the term with the fewest matches (a posting list, or a range
+// of a value index found by binary search), and checks the other terms on
+// just those instructions. So it takes time proportional to the number of
+// matches of the most selective term, rather than to the size of the program.
+//
+// The index refers to the program, which must outlive it. If instructions are
+// appended to the program, update() indexes them.
+class QueryIndex {
+public:
+    QueryIndex(const Program<>&);
+
+    void    update(void);
+
+    // Returns the positions of the instructions that match all of the terms,
+    // in order. Every instruction matches an empty query.
+    std::vector<uint64_t>   query(const std::vector<query_term_t>&) const;
+
+    // The number of instructions that have been indexed.
+    uint64_t    size(void) const;
+private:
+    typedef std::pair<any_t, uint64_t> value_entry_t;
+
+    struct property_index_t {
+        std::vector<uint64_t>       positions;
+        // Numbers come before strings.
+        std::vector<value_entry_t>  by_value;
+    };
+
+    // A term with its handle, and the positions it matches: either a posting
+    // list, or a range of a value index (which is not sorted by position).
+    struct resolved_term_t {
+        const query_term_t*     term;
+        uint32_t                id;
+        const uint64_t*         positions = nullptr;
+        const value_entry_t*    entries = nullptr;
+        size_t                  count = 0;
+    };
+
+    bool    resolve(const query_term_t&, resolved_term_t&) const;
+    bool    matches(const Instruction<>&, const resolved_term_t&) const;
+
+    const Program<>& program;
+    uint64_t n_instructions = 0;
+
+    std::vector<std::vector<uint64_t>>  annotation_positions;   // By annotation id.
+    std::vector<property_index_t>       properties;             // By property id.
+};
+
+}   // qes
+
+#endif  // QES_QUERY_INDEX_h
@@ -0,0 +1,92 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_REGISTRY_h
+#define QES_REGISTRY_h
+
+#include <bit>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace qes {
+
+// Annotation names and property keys are interned into global registries, and
+// instructions store their ids rather than strings. A handle can be resolved
+// once (i.e. outside of a hot loop) and then used for O(1) lookups:
+//
+//      annotation_handle_t no_error = get_annotation_handle("no_error");
+//      for (const auto& inst : program) {
+//          if (inst.has_annotation(no_error)) continue;
+//          ...
+//      }
+//
+// Ids are assigned in order of first use, starting from 0, and are only valid
+// within a process. The registries are thread-safe.
+struct annotation_handle_t {
+    uint32_t id;
+
+    bool operator==(const annotation_handle_t& other) const { return id == other.id; }
+};
+
+struct property_handle_t {
+    uint32_t id;
+
+    bool operator==(const property_handle_t& other) const { return id == other.id; }
+};
+
+// These intern the string if it is new.
+annotation_handle_t get_annotation_handle(std::string);
+property_handle_t   get_property_handle(std::string);
+
+// These return false (and do not intern the string) if the string is new. No
+// instruction can have an annotation or property that was never interned.
+bool    find_annotation_handle(const std::string&, annotation_handle_t&);
+bool    find_property_handle(const std::string&, property_handle_t&);
+
+const std::string&  get_annotation_name(annotation_handle_t);
+const std::string&  get_property_name(property_handle_t);
+
+// String operands and property values (see qes/lang/value.h) are interned into
+// a third registry.
+uint32_t            intern_string(const std::string&);
+const std::string&  get_interned_string(uint32_t);
+
+// id_set_t is a set of ids. Ids below 64 (i.e. the first 64 interned strings)
+// are stored in an inline bitmask, and larger ids in overflow words.
+class id_set_t {
+public:
+    bool    contains(uint32_t) const;
+    // Returns false if the id was already in the set.
+    bool    insert(uint32_t);
+
+    bool    empty(void) const;
+    size_t  size(void) const;
+    // The number of ids in the set that are less than the given id.
+    size_t  rank(uint32_t) const;
+
+    // Calls f(uint32_t) on each id, in increasing order.
+    template <class FUNC> void for_each(FUNC) const;
+
+    bool    operator==(const id_set_t&) const;
+
+    size_t  hash(void) const;
+    size_t  get_heap_bytes(void) const;
+private:
+    uint64_t                low = 0;
+    // high[i] holds ids [64*(i+1), 64*(i+2)). This is only as long as needed
+    // for the largest id (and ids are never removed), so equal sets have equal
+    // representations.
+    std::vector<uint64_t>   high;
+};
+
+}   // qes
+
+#include "registry.inl"
+
+#endif  // QES_REGISTRY_h
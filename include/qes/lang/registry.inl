@@ -0,0 +1,88 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+inline bool
+id_set_t::contains(uint32_t x) const {
+    if (x < 64) return (low >> x) & 1;
+    const size_t w = x/64 - 1;
+    return w < high.size() && ((high[w] >> (x % 64)) & 1);
+}
+
+inline bool
+id_set_t::insert(uint32_t x) {
+    uint64_t* word;
+    if (x < 64) {
+        word = &low;
+    } else {
+        const size_t w = x/64 - 1;
+        if (w >= high.size()) high.resize(w+1, 0);
+        word = &high[w];
+    }
+    const uint64_t bit = uint64_t(1) << (x % 64);
+    if (*word & bit) return false;
+    *word |= bit;
+    return true;
+}
+
+inline bool
+id_set_t::empty() const {
+    if (low != 0) return false;
+    for (uint64_t w : high) {
+        if (w != 0) return false;
+    }
+    return true;
+}
+
+inline size_t
+id_set_t::size() const {
+    size_t n = std::popcount(low);
+    for (uint64_t w : high) n += std::popcount(w);
+    return n;
+}
+
+inline size_t
+id_set_t::rank(uint32_t x) const {
+    const uint64_t below = (uint64_t(1) << (x % 64)) - 1;
+    if (x < 64) return std::popcount(low & below);
+
+    const size_t w = x/64 - 1;
+    size_t n = std::popcount(low);
+    for (size_t i = 0; i < w && i < high.size(); i++) n += std::popcount(high[i]);
+    if (w < high.size()) n += std::popcount(high[w] & below);
+    return n;
+}
+
+template <class FUNC> inline void
+id_set_t::for_each(FUNC f) const {
+    auto visit_word = [&] (uint64_t w, uint32_t base) {
+        while (w) {
+            f(base + static_cast<uint32_t>(std::countr_zero(w)));
+            w &= w-1;
+        }
+    };
+    visit_word(low, 0);
+    for (size_t i = 0; i < high.size(); i++) visit_word(high[i], 64*(i+1));
+}
+
+inline bool
+id_set_t::operator==(const id_set_t& other) const {
+    return low == other.low && high == other.high;
+}
+
+inline size_t
+id_set_t::hash() const {
+    size_t h = std::hash<uint64_t>{}(low);
+    for (uint64_t w : high) h ^= std::hash<uint64_t>{}(w) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    return h;
+}
+
+inline size_t
+id_set_t::get_heap_bytes() const {
+    return high.capacity() * sizeof(uint64_t);
+}
+
+}   // qes
@@ -7,17 +7,26 @@
 #define QES_SAFE_PARSE_h
 
 #include "qes/lang/instruction.h"
+#include "qes/util/profile.h"
 
 #include <iostream>
 
 namespace qes {
 
+class SourceMap;
+
 // This file is dedicated to parsing the baseline Qes language.
 //
 // Extensions to the language will need their own parsing code, but
 // can interface with Instruction and ParseNetwork using the templates.
 
-Program<> safe_read_program(std::istream&);
+// If stats is not null (and QES_PROFILE is defined), the time spent in each
+// phase (lexing, parsing, building the parse network, the parse callbacks, and
+// label resolution) is recorded.
+Program<> safe_read_program(std::istream&, io_stats_t* stats=nullptr);
+// Also records the source location of each instruction (see
+// qes/lang/source_map.h). The map must be empty.
+Program<> safe_read_program(std::istream&, SourceMap&, io_stats_t* stats=nullptr);
 
 }   // qes
 
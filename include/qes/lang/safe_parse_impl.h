@@ -6,7 +6,9 @@
 #ifndef QES_SAFE_PARSE_IMPL_h
 #define QES_SAFE_PARSE_IMPL_h
 
+#include "qes/lang/expression.h"
 #include "qes/lang/instruction.h"
+#include "qes/lang/source_map.h"
 #include "qes/util/parse_network.h"
 
 namespace qes {
@@ -23,6 +25,8 @@ struct network_data_t {
 
     int64_t repeat_count;
     int64_t operand_id;
+    // The loop variable of a repeat block (empty if none).
+    std::string loop_var;
 
     // A pointer to the potential PC.
     sptr<int64_t> pc_ptr;
@@ -33,6 +37,26 @@ struct network_data_t {
     std::map<std::string, any_t>    property_map;
 
     any_t   anyval;
+    // For expression nodes, the expression in reverse Polish notation (for the
+    // *_tail nodes, this is the continuation that follows the left operand).
+    // is_compound is false if the node is just an anyval (and so expr is empty
+    // unless the anyval is an integer or identifier).
+    expr_t  expr;
+    bool    is_compound = false;
+
+    // The parameters of a subroutine definition.
+    std::vector<std::string>    params;
+    // For operands: true if the operands are a call (name(args)), in which
+    // case the arguments are in call_args.
+    bool                is_call = false;
+    std::vector<any_t>  call_args;
+    // For start: true if the block contains a definition.
+    bool    has_definition = false;
+
+    // Only if token positions are set: the location of inst, and of each
+    // instruction in inst_block.
+    source_location_t   location;
+    SourceMap           locations;
 };
 
 typedef ParseNetwork<network_data_t>    QesParseNetwork;
@@ -52,6 +76,20 @@ int64_t increment_pc(int64_t by);
 
 void    replace_id_refs_with_pc(Instruction<>&);
 void    replace_id_refs_with_pc(Program<>&);
+// Exits if any variables or expressions remain (i.e., a variable was used where
+// it is not defined). Must be called after replace_id_refs_with_pc.
+void    check_expressions_evaluated(const Program<>&);
+
+// Calls are parsed as placeholder instructions, and are expanded once the
+// whole program (and so every definition) has been parsed. If locations is not
+// null, it is updated to match: each call's instructions are located at the
+// call.
+void    clear_subroutines(void);
+void    expand_calls(Program<>&, SourceMap* locations=nullptr);
+
+// If not null, the parse functions record source locations, where positions[i]
+// is the position of the i-th token (see Lexer::enable_token_positions).
+void    set_token_positions(const std::vector<token_pos_t>*);
 
 void    p_IDENTIFIER(sptr<QesParseNode>);
 void    p_I_LITERAL(sptr<QesParseNode>);
@@ -64,6 +102,15 @@ void    p_instruction(sptr<QesParseNode>);
 void    p_modifier(sptr<QesParseNode>);
 void    p_operands(sptr<QesParseNode>);
 void    p_anyval(sptr<QesParseNode>);
+void    p_repeat_header(sptr<QesParseNode>);
+void    p_operands_tail(sptr<QesParseNode>);
+void    p_expr(sptr<QesParseNode>);
+void    p_expr_tail(sptr<QesParseNode>);
+void    p_term(sptr<QesParseNode>);
+void    p_term_tail(sptr<QesParseNode>);
+void    p_factor(sptr<QesParseNode>);
+void    p_params(sptr<QesParseNode>);
+void    p_params_tail(sptr<QesParseNode>);
 
 }   // qes
 
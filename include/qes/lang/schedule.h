@@ -0,0 +1,49 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_SCHEDULE_h
+#define QES_SCHEDULE_h
+
+#include "qes/lang/block.h"
+
+#include <vector>
+
+#include <stdint.h>
+
+namespace qes {
+
+// The ASAP (as soon as possible) schedule of a program. Non-negative integer
+// operands are qubits, and each instruction is placed in the earliest layer
+// (or moment) after the last instruction on any of its qubits. Instructions
+// without qubits do not depend on anything, and are placed in layer 0.
+//
+// The critical path is weighted by the duration property of each instruction
+// (@property duration 20), which defaults to 1. So, without any durations,
+// the critical path length is the number of layers.
+//
+// The layers are stored in CSR form: the instructions in layer k are
+//      instructions[layer_offsets[k]] ... instructions[layer_offsets[k+1]-1]
+// in program order.
+struct asap_schedule_t {
+    // layer[i] is the layer of instruction i.
+    std::vector<uint32_t>   layer;
+    std::vector<uint64_t>   layer_offsets;
+    std::vector<uint64_t>   instructions;
+
+    double  critical_path_length = 0.0;
+
+    size_t  get_number_of_layers(void) const;
+};
+
+// Both run in a single pass over the (expanded) program, with a frontier array
+// indexed by qubit (so qubits are limited as in QubitIndex; see set_max_qubit).
+// For a block, the repeat blocks and calls are expanded on the fly, so the
+// expanded program is never stored.
+asap_schedule_t asap_schedule(const Program<>&);
+asap_schedule_t asap_schedule(const block_t&);
+
+}   // qes
+
+#endif  // QES_SCHEDULE_h
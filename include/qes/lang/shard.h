@@ -0,0 +1,82 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_SHARD_h
+#define QES_SHARD_h
+
+#include "qes/lang/instruction.h"
+#include "qes/lang/writer.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace qes {
+
+// A partitioner assigns each instruction of a program to one of n_shards
+// shards. get_shard is called once per instruction, in program order, with the
+// instruction, its position, and the size of the program (so it may keep
+// state, i.e., the shard of the previous instruction).
+struct partitioner_t {
+    size_t  n_shards;
+    std::function<size_t(const Instruction<>&, uint64_t pos, uint64_t size)> get_shard;
+};
+
+// Splits the program into n_shards contiguous ranges of (nearly) equal size.
+partitioner_t   range_partitioner(size_t n_shards);
+// Assigns each instruction to the shard of its first qubit (non-negative integer
+// operand). Instructions without qubits stay in the shard of the instruction
+// before them (or shard 0). In the first version, qubit q is in shard
+// shard_of_qubit[q] (and larger qubits are an error). In the second, the qubits
+// are split into groups of group_size consecutive qubits, which are dealt out
+// to the shards round-robin.
+partitioner_t   qubit_group_partitioner(std::vector<size_t> shard_of_qubit);
+partitioner_t   qubit_group_partitioner(int64_t group_size, size_t n_shards);
+
+// A run is the next count instructions of a shard. The program is the runs'
+// instructions, in order.
+struct shard_run_t {
+    size_t      shard;
+    uint64_t    count;
+};
+
+// The manifest of a sharded program. The files are relative to the directory
+// of the manifest. It is written as text:
+//      qes_manifest 1
+//      instructions <n>
+//      shard <k> <file> <number of instructions>
+//      ...
+//      run <shard> <count>
+//      ...
+struct shard_manifest_t {
+    uint64_t                    n_instructions = 0;
+    std::vector<std::string>    files;
+    std::vector<uint64_t>       sizes;
+    std::vector<shard_run_t>    runs;
+};
+
+shard_manifest_t    partition_program(const Program<>&, const partitioner_t&);
+
+// Writes the shards to <prefix>.<k>.qes and the manifest to <prefix>.manifest.
+// The shards are formatted and written in parallel, one shard per thread (if
+// n_threads is 0, std::thread::hardware_concurrency() threads are used).
+//
+// A shard is a subsequence of the program, so any repeat structure within it
+// is kept by writing it rerolled (see write_mode_t), which is the default.
+shard_manifest_t    write_shards(std::string prefix, const Program<>&, const partitioner_t&,
+                        write_mode_t mode=write_mode_t::rerolled, size_t n_threads=0);
+
+void                write_manifest(std::string file, const shard_manifest_t&);
+shard_manifest_t    read_manifest(std::string file);
+// Reads the shards in parallel and reassembles the program. Exits if a shard
+// does not have as many instructions as the manifest says.
+Program<>           read_shards(std::string manifest_file, size_t n_threads=0);
+
+}   // qes
+
+#endif  // QES_SHARD_h
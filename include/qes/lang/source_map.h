@@ -0,0 +1,90 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_SOURCE_MAP_h
+#define QES_SOURCE_MAP_h
+
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace qes {
+
+// Where an instruction was written: the line and column (both from 1) of the
+// statement, and the iteration of the outermost repeat block containing it (0
+// if there is none).
+//
+// An instruction that comes from a call or include is located at the call or
+// include statement.
+struct source_location_t {
+    uint64_t line = 0;
+    uint64_t col = 0;
+    uint64_t iteration = 0;
+
+    bool operator==(const source_location_t&) const = default;
+};
+
+// SourceMap is an optional side table that maps each instruction of a program
+// (by position) to its source location. It is filled by the readers when asked
+// to (see fast_read_program and safe_read_program), so programs that are read
+// without one pay nothing:
+//
+//      SourceMap locations;
+//      Program<> program = fast_read_program(fin, locations);
+//      source_location_t loc = locations.get(k);  // Where program[k] is from.
+//
+// Consecutive instructions with the same location (i.e., from a call) form a
+// run. Each run is stored as its length and the change in each field from the
+// previous run, as (zigzag) varints, so a run usually takes 4 bytes. Every
+// CHECKPOINT_INTERVAL runs, the absolute location is saved as a checkpoint, so
+// get() binary searches the checkpoints and decodes at most that many runs.
+class SourceMap {
+public:
+    constexpr static size_t CHECKPOINT_INTERVAL = 64;
+
+    // Locates the next count instructions at the given location.
+    void    push(const source_location_t&, uint64_t count=1);
+    // Appends the locations of another map. In the second version, the
+    // locations are those of the given iteration of a repeat block (i.e., the
+    // iterations of the other map are replaced).
+    void    append(const SourceMap&);
+    void    append(const SourceMap&, uint64_t iteration);
+
+    // Returns the location of instruction k < size(). Takes O(log n) time.
+    source_location_t   get(uint64_t k) const;
+
+    // The number of instructions that have been located.
+    uint64_t    size(void) const;
+    // The number of bytes used by the encoded runs and the checkpoints.
+    size_t      get_memory_usage(void) const;
+private:
+    struct checkpoint_t {
+        uint64_t            first_instruction;
+        uint64_t            offset;
+        // The location of the run before the checkpoint (i.e., the base of the
+        // first delta).
+        source_location_t   prev;
+    };
+
+    // Encodes the current run.
+    void    close_run(void);
+
+    template <class FUNC> void  for_each_run(FUNC) const;
+
+    std::vector<uint8_t>        data;
+    std::vector<checkpoint_t>   checkpoints;
+    uint64_t                    n_closed_runs = 0;
+    uint64_t                    n_closed_instructions = 0;
+    source_location_t           last_closed;
+
+    // The current run is kept decoded, so it can still grow.
+    source_location_t   curr;
+    uint64_t            curr_count = 0;
+};
+
+}   // qes
+
+#endif  // QES_SOURCE_MAP_h
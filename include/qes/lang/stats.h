@@ -0,0 +1,57 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_STATS_h
+#define QES_STATS_h
+
+#include "qes/lang/block.h"
+
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <stdint.h>
+
+namespace qes {
+
+// Resource counts of a program. All counts are over the expanded program (so
+// an instruction in a repeat(100) block is counted 100 times).
+struct program_stats_t {
+    uint64_t    n_instructions = 0;
+    uint64_t    n_operands = 0;
+    // The largest integer operand, or -1 if there are none. For a block, an
+    // operand that is an expression is bounded with get_range (see
+    // expression.h), and the parameters of a call are bounded by the ranges
+    // of their arguments separately (so for call f(i, i+1), the parameters
+    // may take values that no call does). So for a block this is an upper
+    // bound, while for a Program<> it is exact.
+    int64_t     max_qubit = -1;
+
+    std::map<std::string, uint64_t> gate_counts;
+    std::map<std::string, uint64_t> annotation_counts;
+    std::map<std::string, uint64_t> property_counts;
+
+    bool operator==(const program_stats_t&) const;
+
+    program_stats_t& operator+=(const program_stats_t&);
+    program_stats_t& operator*=(uint64_t);
+};
+
+// program_stats(std::istream&) reads the program without expanding repeat
+// blocks, and so runs in time proportional to the size of the source rather
+// than the size of the expanded program.
+program_stats_t program_stats(std::istream&);
+program_stats_t program_stats(const block_t&);
+program_stats_t program_stats(const Program<>&);
+
+void    add_instruction(program_stats_t&, const Instruction<>&);
+
+std::ostream& operator<<(std::ostream&, const program_stats_t&);
+
+}   // qes
+
+#include "stats.inl"
+
+#endif  // QES_STATS_h
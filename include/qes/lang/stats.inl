@@ -0,0 +1,23 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+inline bool
+program_stats_t::operator==(const program_stats_t& other) const {
+    return n_instructions == other.n_instructions
+        && n_operands == other.n_operands
+        && max_qubit == other.max_qubit
+        && gate_counts == other.gate_counts
+        && annotation_counts == other.annotation_counts
+        && property_counts == other.property_counts;
+}
+
+inline program_stats_t
+program_stats(std::istream& fin) {
+    return program_stats(read_compressed_program(fin));
+}
+
+}   // qes
@@ -0,0 +1,128 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_VALUE_h
+#define QES_VALUE_h
+
+#include "qes/lang/registry.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <variant>
+
+#include <stdint.h>
+
+namespace qes {
+
+// See qes/lang/expression.h.
+struct shared_expr_t;
+
+void        retain_expression(const shared_expr_t*);
+void        release_expression(const shared_expr_t*);
+std::string print_expression(const shared_expr_t*);
+
+// value_t is the default operand and property type. It holds an int64_t, a
+// double, or a string, like std::variant<int64_t, double, std::string>, but
+// is 16 bytes rather than 40: strings are interned into a shared string pool
+// (see intern_string in qes/lang/registry.h), and the value only stores the
+// string's id. So, copying a value never allocates.
+//
+// The alternatives have the same indices as in the variant (0 = int64_t,
+// 1 = double, 2 = std::string), and qes::get, qes::holds_alternative, and
+// qes::visit work like their std:: counterparts (and also accept std::variant).
+//
+// In a compressed program (see qes/lang/block.h), a value may also be an
+// unevaluated expression over loop variables (index 3; see
+// qes/lang/expression.h). The values that refer to an expression share it,
+// and it is freed with the last of them. qes::visit throws
+// std::bad_variant_access for such a value.
+class value_t {
+public:
+    value_t(void);
+    template <std::integral T>          value_t(T);
+    template <std::floating_point T>    value_t(T);
+    value_t(const std::string&);
+    value_t(const char*);
+    // Takes over one reference to the expression.
+    explicit value_t(const shared_expr_t*);
+
+    value_t(const value_t&);
+    value_t(value_t&&);
+    ~value_t(void);
+
+    value_t& operator=(const value_t&);
+    value_t& operator=(value_t&&);
+
+    size_t  index(void) const;
+
+    // These throw std::bad_variant_access if the value holds another type.
+    int64_t             get_int(void) const;
+    double              get_double(void) const;
+    const std::string&  get_string(void) const;
+    // The id of the string in the string pool.
+    uint32_t            get_string_id(void) const;
+    const shared_expr_t* get_expression(void) const;
+
+    bool    is_expression(void) const;
+
+    bool    operator==(const value_t&) const;
+    // Orders by index, and then by value (as std::variant does). Expressions
+    // are compared by identity.
+    bool    operator<(const value_t&) const;
+
+    size_t  hash(void) const;
+private:
+    enum : uint8_t { INT = 0, DOUBLE = 1, STRING = 2, EXPRESSION = 3 };
+
+    union {
+        int64_t                 i;
+        double                  d;
+        uint32_t                s;
+        const shared_expr_t*    e;
+    };
+    uint8_t tag;
+};
+
+template <class T> decltype(auto)   get(const value_t&);
+template <class T> bool             holds_alternative(const value_t&);
+// Calls f(int64_t), f(double), or f(const std::string&).
+template <class FUNC> decltype(auto) visit(FUNC&&, const value_t&);
+
+template <class T, class... Ts> const T&    get(const std::variant<Ts...>&);
+template <class T, class... Ts> bool        holds_alternative(const std::variant<Ts...>&);
+template <class FUNC, class... Ts> decltype(auto) visit(FUNC&&, const std::variant<Ts...>&);
+
+// Writes a double so that it reads back as the same double: in fixed notation
+// (the tokenizer does not read exponents), with the fewest digits that do so
+// (at most max_digits10 significant digits), and always with a '.' so that it
+// is not read back as an integer.
+std::ostream& print_double(std::ostream&, double);
+// Writes x with operator<<, except that doubles are written with
+// print_double.
+template <class T> std::ostream& print_value(std::ostream&, const T& x);
+
+// Expressions are printed as they were written (see print_expression).
+// Doubles are printed with print_double.
+std::ostream& operator<<(std::ostream&, const value_t&);
+
+}   // qes
+
+namespace std {
+
+template <>
+struct hash<qes::value_t> {
+    size_t operator()(const qes::value_t& x) const { return x.hash(); }
+};
+
+}   // std
+
+#include "value.inl"
+
+#endif  // QES_VALUE_h
@@ -0,0 +1,218 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+inline
+value_t::value_t()
+    :i(0),
+    tag(INT)
+{}
+
+template <std::integral T> inline
+value_t::value_t(T x)
+    :i(static_cast<int64_t>(x)),
+    tag(INT)
+{}
+
+template <std::floating_point T> inline
+value_t::value_t(T x)
+    :d(static_cast<double>(x)),
+    tag(DOUBLE)
+{}
+
+inline
+value_t::value_t(const std::string& x)
+    :s(intern_string(x)),
+    tag(STRING)
+{}
+
+inline
+value_t::value_t(const char* x)
+    :value_t(std::string(x))
+{}
+
+inline
+value_t::value_t(const shared_expr_t* x)
+    :e(x),
+    tag(EXPRESSION)
+{}
+
+inline
+value_t::value_t(const value_t& other)
+    :i(other.i),
+    tag(other.tag)
+{
+    if (tag == EXPRESSION) retain_expression(e);
+}
+
+inline
+value_t::value_t(value_t&& other)
+    :i(other.i),
+    tag(other.tag)
+{
+    other.i = 0;
+    other.tag = INT;
+}
+
+inline
+value_t::~value_t() {
+    if (tag == EXPRESSION) release_expression(e);
+}
+
+inline value_t&
+value_t::operator=(const value_t& other) {
+    if (other.tag == EXPRESSION) retain_expression(other.e);
+    if (tag == EXPRESSION) release_expression(e);
+    i = other.i;
+    tag = other.tag;
+    return *this;
+}
+
+inline value_t&
+value_t::operator=(value_t&& other) {
+    if (this == &other) return *this;
+    if (tag == EXPRESSION) release_expression(e);
+    i = other.i;
+    tag = other.tag;
+    other.i = 0;
+    other.tag = INT;
+    return *this;
+}
+
+inline size_t
+value_t::index() const {
+    return tag;
+}
+
+inline int64_t
+value_t::get_int() const {
+    if (tag != INT) throw std::bad_variant_access();
+    return i;
+}
+
+inline double
+value_t::get_double() const {
+    if (tag != DOUBLE) throw std::bad_variant_access();
+    return d;
+}
+
+inline const std::string&
+value_t::get_string() const {
+    if (tag != STRING) throw std::bad_variant_access();
+    return get_interned_string(s);
+}
+
+inline uint32_t
+value_t::get_string_id() const {
+    if (tag != STRING) throw std::bad_variant_access();
+    return s;
+}
+
+inline const shared_expr_t*
+value_t::get_expression() const {
+    if (tag != EXPRESSION) throw std::bad_variant_access();
+    return e;
+}
+
+inline bool
+value_t::is_expression() const {
+    return tag == EXPRESSION;
+}
+
+inline bool
+value_t::operator==(const value_t& other) const {
+    if (tag != other.tag) return false;
+    if (tag == INT)     return i == other.i;
+    if (tag == DOUBLE)  return d == other.d;
+    if (tag == STRING)  return s == other.s;
+    return e == other.e;
+}
+
+inline bool
+value_t::operator<(const value_t& other) const {
+    if (tag != other.tag) return tag < other.tag;
+    if (tag == INT)     return i < other.i;
+    if (tag == DOUBLE)  return d < other.d;
+    if (tag == STRING)  return s != other.s && get_string() < other.get_string();
+    return std::less<const shared_expr_t*>{}(e, other.e);
+}
+
+inline size_t
+value_t::hash() const {
+    size_t h;
+    if (tag == INT)         h = std::hash<int64_t>{}(i);
+    else if (tag == DOUBLE) h = std::hash<double>{}(d);
+    else if (tag == STRING) h = std::hash<uint32_t>{}(s);
+    else                    h = std::hash<const shared_expr_t*>{}(e);
+    return h ^ (static_cast<size_t>(tag) << 62);
+}
+
+template <class T> inline decltype(auto)
+get(const value_t& x) {
+    if constexpr (std::is_same_v<T, int64_t>) {
+        return x.get_int();
+    } else if constexpr (std::is_same_v<T, double>) {
+        return x.get_double();
+    } else {
+        static_assert(std::is_same_v<T, std::string>, "value_t holds int64_t, double, or std::string");
+        return x.get_string();
+    }
+}
+
+template <class T> inline bool
+holds_alternative(const value_t& x) {
+    if constexpr (std::is_same_v<T, int64_t>)       return x.index() == 0;
+    else if constexpr (std::is_same_v<T, double>)   return x.index() == 1;
+    else                                            return x.index() == 2;
+}
+
+template <class FUNC> inline decltype(auto)
+visit(FUNC&& f, const value_t& x) {
+    if (x.index() == 0)         return f(x.get_int());
+    else if (x.index() == 1)    return f(x.get_double());
+    else                        return f(x.get_string());  // Throws for an expression.
+}
+
+template <class T, class... Ts> inline const T&
+get(const std::variant<Ts...>& x) {
+    return std::get<T>(x);
+}
+
+template <class T, class... Ts> inline bool
+holds_alternative(const std::variant<Ts...>& x) {
+    return std::holds_alternative<T>(x);
+}
+
+template <class FUNC, class... Ts> inline decltype(auto)
+visit(FUNC&& f, const std::variant<Ts...>& x) {
+    return std::visit(std::forward<FUNC>(f), x);
+}
+
+inline std::ostream&
+print_double(std::ostream& out, double x) {
+    // The shortest fixed representation of a double has at most 17
+    // significant digits, but may have up to 308 zeros around them.
+    char buf[400];
+    const auto [ end, ec ] = std::to_chars(buf, buf + sizeof(buf), x, std::chars_format::fixed);
+    out.write(buf, end - buf);
+    if (std::isfinite(x) && std::find(buf, end, '.') == end) out << ".0";
+    return out;
+}
+
+template <class T> inline std::ostream&
+print_value(std::ostream& out, const T& x) {
+    if constexpr (std::is_same_v<T, double>)    return print_double(out, x);
+    else                                        return out << x;
+}
+
+inline std::ostream&
+operator<<(std::ostream& out, const value_t& x) {
+    if (x.is_expression()) return out << print_expression(x.get_expression());
+    visit([&] (const auto& v) { print_value(out, v); }, x);
+    return out;
+}
+
+}   // qes
@@ -0,0 +1,55 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_WRITER_h
+#define QES_WRITER_h
+
+#include "qes/lang/block.h"
+#include "qes/lang/instruction.h"
+#include "qes/util/profile.h"
+
+#include <iostream>
+
+namespace qes {
+
+// Writes print_prog(program) to the output stream, formatting ranges of the
+// program in parallel. The program is split into chunks of chunk_size
+// instructions, which worker threads format into their own buffers. The
+// calling thread writes finished buffers in order, so the output is
+// byte-identical to print_prog. At most 2*n_threads buffers are held at once.
+//
+// If n_threads is 0, std::thread::hardware_concurrency() threads are used.
+//
+// If stats is given (and qes was compiled with QES_PROFILE), the "format"
+// phase records the time spent formatting chunks, summed over the worker
+// threads (so it may exceed the wall time of the call), and the "write" phase
+// records the time the calling thread spends writing buffers to the stream.
+template <class T, class U>
+void write_prog(std::ostream&, const Program<T, U>&, size_t n_threads=0, size_t chunk_size=4096,
+        io_stats_t* stats=nullptr);
+
+// Programs can be written flat (as print_prog does), or rerolled: periodic runs
+// of structurally equal instructions are written as repeat blocks, so that a
+// program read from repeat(100000) { ... } is not written 100000 times larger.
+// Reading a rerolled program gives back the same flat program (doubles are
+// written with print_double, so they read back exactly; see value.h).
+enum class write_mode_t { flat, rerolled };
+
+// Finds the periodic runs with rolling hashes over the instructions, in near
+// linear time. The candidate periods at each position are the distances to the
+// next few copies of the same statement. To find longer periods (and nested
+// ones), each pass rerolls the statements of the previous pass until no more
+// runs are found, and the bodies of runs are rerolled on their own.
+block_t     reroll_program(const Program<>&);
+// Prints a block with repeat blocks (which must not have loop variables or
+// calls, as with reroll_program).
+std::string print_block(const block_t&);
+void        write_rerolled_prog(std::ostream&, const Program<>&);
+
+}   // qes
+
+#include "writer.inl"
+
+#endif  // QES_WRITER_h
@@ -0,0 +1,131 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qes {
+
+template <class T, class U> inline std::string
+format_range(const Program<T, U>& program, size_t begin, size_t end) {
+    std::string out;
+    for (size_t i = begin; i < end; i++) {
+        if (i > 0) out += "\n";
+        out += print_inst(program[i], false);
+    }
+    return out;
+}
+
+// Adds the phase of one chunk to the phase of the whole program.
+inline void
+add_phase(phase_stats_t& to, const phase_stats_t& from) {
+    to.wall_time_ns += from.wall_time_ns;
+    to.allocations += from.allocations;
+    to.allocated_bytes += from.allocated_bytes;
+}
+
+template <class T, class U> void
+write_prog(std::ostream& out, const Program<T, U>& program, size_t n_threads, size_t chunk_size, io_stats_t* stats) {
+    if (n_threads == 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (chunk_size == 0) chunk_size = 1;
+
+    QES_IF_PROFILE(
+        phase_stats_t* format_phase = nullptr;
+        phase_stats_t* write_phase = nullptr;
+        if (stats != nullptr) {
+            format_phase = &stats->get("format");
+            write_phase = &stats->get("write");
+        }
+    )
+    uint64_t n_bytes = 0;
+
+    const size_t n_chunks = (program.size() + chunk_size - 1) / chunk_size;
+    if (n_threads == 1 || n_chunks <= 1) {
+        std::string s;
+        {
+            QES_IF_PROFILE(PhaseTimer timer(format_phase);)
+            s = format_range(program, 0, program.size());
+        }
+        {
+            QES_IF_PROFILE(PhaseTimer timer(write_phase);)
+            out.write(s.data(), s.size());
+        }
+        n_bytes = s.size();
+    } else {
+        n_threads = std::min(n_threads, n_chunks);
+        const size_t window = 2*n_threads;
+
+        std::vector<std::string>    buffers(n_chunks);
+        std::vector<bool>           is_ready(n_chunks, false);
+        size_t next_chunk = 0;
+        size_t n_written = 0;
+
+        std::mutex mtx;
+        std::condition_variable cv;
+
+        auto worker = [&] () {
+            while (true) {
+                size_t k;
+                {
+                    std::unique_lock<std::mutex> lk(mtx);
+                    // Do not get more than `window` chunks ahead of the writer.
+                    cv.wait(lk, [&] () { return next_chunk >= n_chunks || next_chunk < n_written + window; });
+                    if (next_chunk >= n_chunks) return;
+                    k = next_chunk++;
+                }
+                // Each worker times its chunk on its own, and then adds the
+                // time to the format phase while holding the lock.
+                std::string s;
+                QES_IF_PROFILE(phase_stats_t chunk_phase;)
+                {
+                    QES_IF_PROFILE(PhaseTimer timer(format_phase == nullptr ? nullptr : &chunk_phase);)
+                    s = format_range(program, k*chunk_size, std::min((k+1)*chunk_size, program.size()));
+                }
+                {
+                    std::lock_guard<std::mutex> lk(mtx);
+                    QES_IF_PROFILE(if (format_phase != nullptr) add_phase(*format_phase, chunk_phase);)
+                    buffers[k] = std::move(s);
+                    is_ready[k] = true;
+                }
+                cv.notify_all();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < n_threads; i++) threads.emplace_back(worker);
+        // Write the chunks in order.
+        for (size_t k = 0; k < n_chunks; k++) {
+            std::string s;
+            {
+                std::unique_lock<std::mutex> lk(mtx);
+                cv.wait(lk, [&] () { return is_ready[k]; });
+                s = std::move(buffers[k]);
+            }
+            {
+                QES_IF_PROFILE(PhaseTimer timer(write_phase);)
+                out.write(s.data(), s.size());
+            }
+            n_bytes += s.size();
+            {
+                std::lock_guard<std::mutex> lk(mtx);
+                n_written++;
+            }
+            cv.notify_all();
+        }
+        for (auto& t : threads) t.join();
+    }
+    QES_IF_PROFILE(
+        if (stats != nullptr) {
+            format_phase->instructions += program.size();
+            format_phase->bytes += n_bytes;
+            write_phase->bytes += n_bytes;
+        }
+    )
+}
+
+}   // qes
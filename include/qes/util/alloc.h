@@ -0,0 +1,33 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_ALLOC_h
+#define QES_ALLOC_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace qes {
+
+// Allocation accounting. The counters only advance if the counting hook is
+// linked into the executable (the qes_alloc_hook CMake target), which replaces
+// the global operator new and delete. Without the hook, the counters stay 0.
+//
+// Counters are per-thread, so a phase only counts its own thread's allocations.
+struct alloc_counters_t {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+alloc_counters_t    get_alloc_counters(void);
+bool                alloc_hook_is_installed(void);
+
+// Called by the hook.
+void    record_allocation(size_t);
+void    set_alloc_hook_installed(void);
+
+}   // qes
+
+#endif  // QES_ALLOC_h
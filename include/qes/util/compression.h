@@ -0,0 +1,110 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_COMPRESSION_h
+#define QES_COMPRESSION_h
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+
+namespace qes {
+
+// Compressed files are detected by their magic bytes (when reading) or by
+// their extension (".gz" or ".zst"). Support for each format depends on
+// whether zlib (QES_USE_ZLIB) and zstd (QES_USE_ZSTD) were found by CMake.
+enum class compression_t { none, gzip, zstd };
+
+compression_t   compression_from_extension(std::string);
+compression_t   detect_compression(std::string file);
+
+bool    compression_is_supported(compression_t);
+// Exits if the compression format was not compiled in.
+void    test_compression_is_supported(compression_t, std::string file);
+
+// DecompressStreambuf decompresses a file on a background thread. The thread
+// fills up to `max_blocks` output blocks ahead of the reader, so decompression
+// overlaps with tokenizing and parsing.
+class DecompressStreambuf : public std::streambuf {
+public:
+    DecompressStreambuf(std::string file, compression_t,
+                        size_t block_size=1<<20, size_t max_blocks=4);
+    ~DecompressStreambuf(void);
+protected:
+    int_type underflow(void) override;
+private:
+    void    run(void);
+    void    run_gzip(void);
+    void    run_zstd(void);
+    // Called by the background thread. Blocks if max_blocks are waiting.
+    void    push_block(std::vector<char>&&);
+
+    FILE*           fp;
+    compression_t   type;
+    size_t          block_size;
+    size_t          max_blocks;
+
+    std::vector<char>               curr_block;
+    std::deque<std::vector<char>>   blocks;
+    bool                            done;
+    std::atomic<bool>               stop;
+
+    std::mutex              mtx;
+    std::condition_variable cv;
+    std::thread             worker;
+};
+
+// CompressStreambuf compresses everything written to it into a file.
+class CompressStreambuf : public std::streambuf {
+public:
+    CompressStreambuf(std::string file, compression_t, size_t block_size=1<<20);
+    ~CompressStreambuf(void);
+protected:
+    int_type    overflow(int_type) override;
+    int         sync(void) override;
+private:
+    void    compress_buffer(bool finish);
+
+    FILE*           fp;
+    compression_t   type;
+    void*           ctx;
+
+    std::vector<char>   in_buf;
+    std::vector<char>   out_buf;
+};
+
+// compressed_ifstream and compressed_ofstream behave like std::ifstream and
+// std::ofstream, but transparently (de)compress the file if necessary.
+// Uncompressed regular files are read ahead on a background thread (see
+// qes/util/readahead.h). Other files (i.e., pipes) are read with a
+// std::filebuf.
+class compressed_ifstream : public std::istream {
+public:
+    compressed_ifstream(std::string file);
+private:
+    std::unique_ptr<std::streambuf> buf;
+};
+
+class compressed_ofstream : public std::ostream {
+public:
+    compressed_ofstream(std::string file);
+private:
+    std::unique_ptr<std::streambuf> buf;
+};
+
+}   // qes
+
+#include "compression.inl"
+
+#endif  // QES_COMPRESSION_h
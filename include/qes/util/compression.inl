@@ -0,0 +1,18 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+inline compression_t
+compression_from_extension(std::string file) {
+    auto ends_with = [&] (std::string ext) {
+        return file.size() >= ext.size() && file.compare(file.size()-ext.size(), ext.size(), ext) == 0;
+    };
+    if (ends_with(".gz"))   return compression_t::gzip;
+    if (ends_with(".zst"))  return compression_t::zstd;
+    return compression_t::none;
+}
+
+}   // qes
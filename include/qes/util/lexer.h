@@ -31,7 +31,7 @@ class Lexer {
 public:
     Lexer(std::string lexer_file);
 
-    bool matches(std::string, token_type);
+    bool matches(const std::string&, token_type);
 
     // read_tokens is the function that perform lexical_analysis.
     // Passing in a std::string analyzes that string, whereas
@@ -41,12 +41,25 @@ public:
     void read_tokens(std::istream&);
 
     std::vector<Token> get_tokens(void);
+    // If enabled (before read_tokens), the position of each token is recorded:
+    // get_token_positions()[i] is the position of get_tokens()[i].
+    void                        enable_token_positions(void);
+    std::vector<token_pos_t>    get_token_positions(void);
+    // Returns the number of characters consumed by read_tokens.
+    size_t get_number_of_bytes_read(void);
 private:
     std::vector<token_type>             token_order;
     std::map<token_type, std::regex>    regex_map;
     std::set<token_type>                token_ignore_set;
+    // Tokens that are their own regex (including keywords) are matched by
+    // string comparison, which is much cheaper than std::regex_match.
+    std::map<token_type, std::string>   literal_map;
 
     std::vector<Token> tokens;
+    size_t bytes_read;
+
+    bool                        record_positions = false;
+    std::vector<token_pos_t>    positions;
 };
 
 }   // qes
@@ -8,7 +8,9 @@
 namespace qes {
 
 inline bool
-Lexer::matches(std::string text, token_type t) {
+Lexer::matches(const std::string& text, token_type t) {
+    auto it = literal_map.find(t);
+    if (it != literal_map.end()) return text == it->second;
     return std::regex_match(text, regex_map.at(t));
 }
 
@@ -23,4 +25,19 @@ Lexer::get_tokens() {
     return tokens;
 }
 
+inline void
+Lexer::enable_token_positions() {
+    record_positions = true;
+}
+
+inline std::vector<token_pos_t>
+Lexer::get_token_positions() {
+    return positions;
+}
+
+inline size_t
+Lexer::get_number_of_bytes_read() {
+    return bytes_read;
+}
+
 }   // qes
@@ -0,0 +1,41 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_PARSE_CACHE_h
+#define QES_PARSE_CACHE_h
+
+#include "qes/lang/instruction.h"
+
+#include <string>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace qes {
+
+// The parse cache is an optional, content-addressed layer behind from_file.
+// When enabled, from_file hashes the bytes of the input file and looks up a
+// serialized program (see qes/lang/binary.h) in the cache directory. On a hit,
+// the serialized program is loaded instead of parsing the input.
+//
+// Entries are keyed by the content hash, the library version, and the grammar
+// version, so stale entries are never used. Entries are written to a temporary
+// file and renamed into place, so any number of processes can share a cache
+// directory. Once the directory exceeds max_bytes, the least recently used
+// entries are evicted.
+void    enable_parse_cache(std::string directory, size_t max_bytes=(1ull << 30));
+void    disable_parse_cache(void);
+bool    parse_cache_is_enabled(void);
+
+Program<>   cached_read_from_file(std::string);
+
+// Returns the cache key for a file with the given contents.
+std::string get_parse_cache_key(const std::string& contents);
+// A 128-bit (non-cryptographic) hash of the given bytes, as 32 hex digits.
+std::string hash_bytes(const char*, size_t);
+
+}   // qes
+
+#endif  // QES_PARSE_CACHE_h
@@ -28,8 +28,10 @@ struct parse_node_t {
 
     std::string tmp_data; // Raw data from recv_token
     bool data_has_been_assigned = false;
-    // Pointers to parent and children:
-    sptr<parse_node_t>              parent = nullptr;
+    // For leaves: the index of the token (in the order they were received).
+    size_t token_index = 0;
+    // Pointers to parent and children (a node is owned by its parent):
+    std::weak_ptr<parse_node_t>     parent;
     std::vector<sptr<parse_node_t>> children;
 };
 
@@ -45,7 +47,8 @@ template <class T>
 class ParseNetwork {
 public:
     ParseNetwork();
-    
+    ~ParseNetwork();
+
     void    recv_rule(rule_t);
     void    recv_token(Token);
 
@@ -56,6 +59,8 @@ public:
     sptr<parse_node_t<T>>              root;
     std::vector<sptr<parse_node_t<T>>> leaves;
 private:
+    size_t n_tokens;
+
     sptr<parse_node_t<T>>  make_node(token_type);
 };
 
@@ -11,43 +11,48 @@ namespace qes {
 template <class T>
 ParseNetwork<T>::ParseNetwork()
     :root(nullptr),
-    leaves()
+    leaves(),
+    n_tokens(0)
 {}
 
+template <class T>
+ParseNetwork<T>::~ParseNetwork() {
+    // Free the nodes one at a time: freeing the root directly would recurse as
+    // deep as the tree, which is as deep as the program is long.
+    leaves.clear();
+    std::vector<sptr<parse_node_t<T>>> stack;
+    if (root != nullptr) stack.push_back(std::move(root));
+    while (!stack.empty()) {
+        sptr<parse_node_t<T>> x = std::move(stack.back());
+        stack.pop_back();
+        for (sptr<parse_node_t<T>>& c : x->children) stack.push_back(std::move(c));
+        x->children.clear();
+    }
+}
+
 template <class T> void
 ParseNetwork<T>::recv_rule(rule_t r) {
     // Find first nonterminal == LHS in the leaves.
-    sptr<parse_node_t<T>> branch_src = nullptr;
-
-    std::vector<sptr<parse_node_t<T>>> new_leaves,
-                                        leaves_after_branch;
-    for (sptr<parse_node_t<T>> x : leaves) {
-        if (x->symbol == r.lhs && branch_src == nullptr) {
-            // Create a node for each symbol in the RHS.
-            branch_src = x;
-        } else if (branch_src == nullptr) {
-            new_leaves.push_back(x);
-        } else {
-            leaves_after_branch.push_back(x);
-        }
-    }
-    // branch_src = nullptr or one of the leaves. If branch_src
-    // is null, then that means the tree is empty. Make LHS the
-    // root of the tree.
-    if (branch_src == nullptr) {
+    size_t k = 0;
+    while (k < leaves.size() && leaves[k]->symbol != r.lhs) k++;
+    // If there is no such leaf, then that means the tree is empty. Make LHS
+    // the root of the tree.
+    sptr<parse_node_t<T>> branch_src;
+    if (k == leaves.size()) {
         root = make_node(r.lhs);
-        root->parent = nullptr;
         branch_src = root;
+    } else {
+        branch_src = leaves[k];
+        leaves.erase(leaves.begin() + k);
     }
-    // Expand the tree by branching from branch_src.
+    // Expand the tree by branching from branch_src. The new leaves replace
+    // branch_src in place (this avoids rebuilding the leaf list).
     for (token_type t : r.rhs) {
         sptr<parse_node_t<T>> x = make_node(t);
         x->parent = branch_src;
         branch_src->children.push_back(x);
-        new_leaves.push_back(x);
     }
-    new_leaves.insert(new_leaves.end(), leaves_after_branch.begin(), leaves_after_branch.end());
-    leaves = std::move(new_leaves);
+    leaves.insert(leaves.begin() + k, branch_src->children.begin(), branch_src->children.end());
 }
 
 template <class T> void
@@ -56,10 +61,12 @@ ParseNetwork<T>::recv_token(Token tok) {
     // has not been assigned a value.
     token_type type = std::get<0>(tok);
     std::string value = std::get<1>(tok);
+    const size_t index = n_tokens++;
     for (sptr<parse_node_t<T>> x : leaves) {
         if (x->symbol == type && !x->data_has_been_assigned) {
             x->tmp_data = value;
             x->data_has_been_assigned = true;
+            x->token_index = index;
             return;
         }
     }
@@ -88,7 +95,7 @@ ParseNetwork<T>::apply_callback_bottom_up(FUNC fn) {
         fn(x);
         ready.insert(x);
         // Append parent to list:
-        if (x->parent != nullptr) node_list.push_back(x->parent);
+        if (sptr<parse_node_t<T>> p = x->parent.lock()) node_list.push_back(p);
     }
 }
 
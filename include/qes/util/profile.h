@@ -0,0 +1,84 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_PROFILE_h
+#define QES_PROFILE_h
+
+#include "qes/util/alloc.h"
+#include "qes/util/token.h"
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <utility>
+
+#include <stdint.h>
+
+// Instrumentation of the read and write paths is opt-in: it is only compiled
+// in if QES_PROFILE is defined (cmake -DQES_PROFILE=ON). Otherwise, all code
+// wrapped in QES_IF_PROFILE disappears, and io_stats_t is never filled.
+#ifdef QES_PROFILE
+#define QES_IF_PROFILE(...) __VA_ARGS__
+#else
+#define QES_IF_PROFILE(...)
+#endif
+
+namespace qes {
+
+struct phase_stats_t {
+    uint64_t wall_time_ns = 0;
+    uint64_t tokens = 0;
+    uint64_t instructions = 0;
+    uint64_t bytes = 0;
+    // Only counted if the allocation hook is linked in (see qes/util/alloc.h).
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+};
+
+// io_stats_t holds the statistics of each phase of a read or write, in the
+// order in which the phases were first entered. References returned by get()
+// remain valid as phases are added.
+struct io_stats_t {
+    std::deque<std::pair<std::string, phase_stats_t>> phases;
+
+    // Returns the phase with the given name, creating it if necessary.
+    phase_stats_t&  get(std::string);
+    bool            has(std::string) const;
+};
+
+// Exports the stats as JSON:
+//      { "enabled": true, "phases": [ { "name": ..., "wall_time_ns": ..., ... } ] }
+std::string to_json(const io_stats_t&);
+
+// Adds the lifetime of the timer to the wall time (and the allocations made in
+// that time) of a phase. Does nothing if the phase is null (i.e. the caller did
+// not ask for stats).
+class PhaseTimer {
+public:
+    PhaseTimer(phase_stats_t*);
+    ~PhaseTimer(void);
+private:
+    phase_stats_t* phase;
+    std::chrono::steady_clock::time_point start;
+    alloc_counters_t start_allocs;
+};
+
+// Wraps a callback manager (see LLParser::parse) and times recv_rule and
+// recv_token separately, so that their cost can be separated from the parser's.
+template <class T>
+struct ProfiledCallbackManager {
+    T&              inner;
+    phase_stats_t*  rule_phase;
+    phase_stats_t*  token_phase;
+
+    void    recv_rule(rule_t);
+    void    recv_token(Token);
+};
+
+}   // qes
+
+#include "profile.inl"
+
+#endif  // QES_PROFILE_h
@@ -0,0 +1,60 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+inline phase_stats_t&
+io_stats_t::get(std::string name) {
+    for (auto& [ k, v ] : phases) {
+        if (k == name) return v;
+    }
+    phases.emplace_back(name, phase_stats_t());
+    return phases.back().second;
+}
+
+inline bool
+io_stats_t::has(std::string name) const {
+    for (const auto& [ k, v ] : phases) {
+        if (k == name) return true;
+    }
+    return false;
+}
+
+inline
+PhaseTimer::PhaseTimer(phase_stats_t* p)
+    :phase(p),
+    start(),
+    start_allocs()
+{
+    if (phase == nullptr) return;
+    start_allocs = get_alloc_counters();
+    start = std::chrono::steady_clock::now();
+}
+
+inline
+PhaseTimer::~PhaseTimer() {
+    if (phase == nullptr) return;
+    auto t = std::chrono::steady_clock::now() - start;
+    phase->wall_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+
+    alloc_counters_t allocs = get_alloc_counters();
+    phase->allocations += allocs.count - start_allocs.count;
+    phase->allocated_bytes += allocs.bytes - start_allocs.bytes;
+}
+
+template <class T> inline void
+ProfiledCallbackManager<T>::recv_rule(rule_t r) {
+    PhaseTimer timer(rule_phase);
+    inner.recv_rule(r);
+}
+
+template <class T> inline void
+ProfiledCallbackManager<T>::recv_token(Token tok) {
+    PhaseTimer timer(token_phase);
+    inner.recv_token(tok);
+    if (token_phase != nullptr) token_phase->tokens++;
+}
+
+}   // qes
@@ -0,0 +1,75 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_READAHEAD_h
+#define QES_READAHEAD_h
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace qes {
+
+// ReadAheadStreambuf reads a file in blocks of block_size bytes on a
+// background thread, keeping up to `depth` blocks ahead of the reader (so
+// depth = 2 is double buffering). The kernel is told that the file is read
+// sequentially (posix_fadvise), and blocks are recycled rather than
+// reallocated.
+//
+// Seeking is supported, but restarts the background thread. Only regular files
+// can be read ahead: for any other file (i.e., a pipe), is_open() is false.
+class ReadAheadStreambuf : public std::streambuf {
+public:
+    ReadAheadStreambuf(std::string file, size_t block_size=1<<20, size_t depth=3);
+    ~ReadAheadStreambuf(void);
+
+    bool    is_open(void) const;
+protected:
+    int_type    underflow(void) override;
+    pos_type    seekoff(off_type, std::ios::seekdir, std::ios::openmode) override;
+    pos_type    seekpos(pos_type, std::ios::openmode) override;
+private:
+    struct block_t {
+        std::vector<char>   data;
+        size_t              size;
+    };
+
+    void    start(uint64_t offset);
+    void    stop(void);
+    void    run(uint64_t offset);
+
+    int     fd;
+    size_t  block_size;
+    size_t  depth;
+
+    block_t                 curr_block;
+    uint64_t                curr_block_offset;
+    std::deque<block_t>     blocks;
+    std::vector<block_t>    free_blocks;
+    bool                    done;
+    bool                    stopped;
+
+    std::mutex              mtx;
+    std::condition_variable cv;
+    std::thread             worker;
+};
+
+// compressed_ifstream (see qes/util/compression.h) reads uncompressed files
+// through a ReadAheadStreambuf with these parameters. A depth of 0 disables
+// read-ahead (and a std::filebuf is used instead).
+void    set_read_ahead(size_t block_size, size_t depth);
+size_t  get_read_ahead_block_size(void);
+size_t  get_read_ahead_depth(void);
+
+}   // qes
+
+#endif  // QES_READAHEAD_h
@@ -0,0 +1,67 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#ifndef QES_SPSC_QUEUE_h
+#define QES_SPSC_QUEUE_h
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <vector>
+
+#include <stddef.h>
+
+namespace qes {
+
+// SPSCQueue is a bounded, lock-free ring buffer for exactly one producer
+// thread and one consumer thread. The try_* functions never block. push and
+// pop block (by waiting on the head and tail indices, rather than spinning)
+// while the queue is full or empty, which gives the producer back-pressure.
+//
+// The producer calls close() once it is done. The consumer calls cancel() if it
+// stops early, which makes any blocked or future push fail.
+template <class T>
+class SPSCQueue {
+public:
+    // The capacity is rounded up to a power of two.
+    SPSCQueue(size_t capacity);
+
+    bool    try_push(T&&);
+    bool    try_pop(T&);
+    // Returns false if the consumer cancelled.
+    bool    push(T&&);
+    // Returns false if the queue is empty and closed.
+    bool    pop(T&);
+
+    void    close(void);
+    void    cancel(void);
+
+    bool    is_closed(void) const;
+    bool    is_cancelled(void) const;
+
+    size_t  get_capacity(void) const;
+    // Only approximate while the other thread is running.
+    size_t  size(void) const;
+private:
+    // The top bit of tail (head) is set when the queue is closed (cancelled).
+    // Setting it changes the value, which wakes up a thread waiting on it.
+    static constexpr size_t FLAG = size_t(1) << (8*sizeof(size_t)-1);
+
+    std::vector<T>  slots;
+    const size_t    mask;
+
+    // head is written by the consumer and tail by the producer. They are kept
+    // on separate cache lines, along with each thread's last view of the other.
+    alignas(64) std::atomic<size_t> head;
+    size_t                          tail_cache;
+    alignas(64) std::atomic<size_t> tail;
+    size_t                          head_cache;
+};
+
+}   // qes
+
+#include "spsc_queue.inl"
+
+#endif  // QES_SPSC_QUEUE_h
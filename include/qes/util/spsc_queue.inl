@@ -0,0 +1,104 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+namespace qes {
+
+template <class T>
+SPSCQueue<T>::SPSCQueue(size_t capacity)
+    :slots(std::bit_ceil(std::max(capacity, size_t(1)))),
+    mask(slots.size()-1),
+    head(0),
+    tail_cache(0),
+    tail(0),
+    head_cache(0)
+{}
+
+template <class T> bool
+SPSCQueue<T>::try_push(T&& x) {
+    const size_t t = tail.load(std::memory_order_relaxed) & ~FLAG;
+    if (t - head_cache == slots.size()) {
+        head_cache = head.load(std::memory_order_acquire) & ~FLAG;
+        if (t - head_cache == slots.size()) return false;
+    }
+    slots[t & mask] = std::move(x);
+    tail.store(t+1, std::memory_order_release);
+    tail.notify_one();
+    return true;
+}
+
+template <class T> bool
+SPSCQueue<T>::try_pop(T& x) {
+    const size_t h = head.load(std::memory_order_relaxed) & ~FLAG;
+    if (h == tail_cache) {
+        tail_cache = tail.load(std::memory_order_acquire) & ~FLAG;
+        if (h == tail_cache) return false;
+    }
+    x = std::move(slots[h & mask]);
+    head.store(h+1, std::memory_order_release);
+    head.notify_one();
+    return true;
+}
+
+template <class T> bool
+SPSCQueue<T>::push(T&& x) {
+    const size_t t = tail.load(std::memory_order_relaxed) & ~FLAG;
+    while (true) {
+        size_t h = head.load(std::memory_order_acquire);
+        if (h & FLAG) return false;
+        if (t - h < slots.size()) {
+            head_cache = h;
+            return try_push(std::move(x));
+        }
+        head.wait(h, std::memory_order_acquire);
+    }
+}
+
+template <class T> bool
+SPSCQueue<T>::pop(T& x) {
+    const size_t h = head.load(std::memory_order_relaxed) & ~FLAG;
+    while (true) {
+        size_t t = tail.load(std::memory_order_acquire);
+        if ((t & ~FLAG) != h) {
+            tail_cache = t & ~FLAG;
+            return try_pop(x);
+        }
+        if (t & FLAG) return false;
+        tail.wait(t, std::memory_order_acquire);
+    }
+}
+
+template <class T> void
+SPSCQueue<T>::close() {
+    tail.fetch_or(FLAG, std::memory_order_release);
+    tail.notify_all();
+}
+
+template <class T> void
+SPSCQueue<T>::cancel() {
+    head.fetch_or(FLAG, std::memory_order_release);
+    head.notify_all();
+}
+
+template <class T> bool
+SPSCQueue<T>::is_closed() const {
+    return tail.load(std::memory_order_acquire) & FLAG;
+}
+
+template <class T> bool
+SPSCQueue<T>::is_cancelled() const {
+    return head.load(std::memory_order_acquire) & FLAG;
+}
+
+template <class T> size_t
+SPSCQueue<T>::get_capacity() const {
+    return slots.size();
+}
+
+template <class T> size_t
+SPSCQueue<T>::size() const {
+    return (tail.load(std::memory_order_acquire) & ~FLAG) - (head.load(std::memory_order_acquire) & ~FLAG);
+}
+
+}   // qes
@@ -18,6 +18,12 @@ typedef std::string token_type;
 //  (2) value (std::string)
 typedef std::tuple<token_type, std::string> Token;
 
+// The line and column (both from 1) of the first character of a token.
+struct token_pos_t {
+    size_t line;
+    size_t col;
+};
+
 const token_type T_undefined = "undefined";
 const token_type T_empty = "empty";
 
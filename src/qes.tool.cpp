@@ -0,0 +1,308 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include <qes.h>
+#include <qes/lang/binary.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <thread>
+
+#include <errno.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace qes;
+
+// The qes tool. Every command streams the input: text files are read one
+// top-level statement at a time and expanded on the fly, and binary files (see
+// qes/lang/binary.h) one instruction at a time, so memory does not grow with
+// the size of the program.
+
+static const char* USAGE =
+    "usage: qes <command> [options] <file>...\n"
+    "\n"
+    "commands:\n"
+    "   cat [--compact] [--window N] <file>\n"
+    "       Prints the program, one instruction per line. With --compact, periodic\n"
+    "       runs are printed as repeat blocks (found in windows of N instructions).\n"
+    "   stats <file>\n"
+    "       Prints the gate, operand, annotation, and property counts.\n"
+    "   filter [--name N] [--annotation A] [--property P] <file>\n"
+    "       Prints the instructions that match all of the given conditions.\n"
+    "   convert <input> <output>\n"
+    "       Converts between text and binary. The output is binary if it ends in\n"
+    "       .qesb (or .qesb.gz, .qesb.zst).\n"
+    "   validate [-j N] <file>...\n"
+    "       Parses the files, N at a time, and reports which are invalid.\n"
+    "\n"
+    "Inputs may be text or binary, and may be compressed (.gz or .zst).\n";
+
+static const uint64_t DEFAULT_COMPACT_WINDOW = 65536;
+
+[[noreturn]] static void
+exit_with_usage() {
+    std::cerr << USAGE;
+    exit(1);
+}
+
+// Returns the count given for an option, or exits with the usage if it is not
+// a non-negative integer.
+static uint64_t
+parse_count(const std::string& s) {
+    uint64_t x;
+    auto [ end, ec ] = std::from_chars(s.data(), s.data() + s.size(), x);
+    if (ec != std::errc() || end != s.data() + s.size()) exit_with_usage();
+    return x;
+}
+
+static std::string
+to_lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [] (unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+static bool
+ends_with(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool
+is_binary_file(const std::string& file) {
+    compressed_ifstream fin(file);
+    if (!fin.good()) {
+        std::cerr << "[ qes ] could not read \"" << file << "\"." << std::endl;
+        exit(1);
+    }
+    return read_binary_header(fin);
+}
+
+// Calls f(Instruction<>&&) on each instruction of the file, in order.
+template <class FUNC> static void
+for_each_instruction(const std::string& file, FUNC f) {
+    const bool is_binary = is_binary_file(file);
+    IncludeGuard guard(file);
+    compressed_ifstream fin(file);
+    if (is_binary) {
+        read_binary_header(fin);
+        Instruction<> inst;
+        while (read_binary_inst(fin, inst)) f(std::move(inst));
+        if (fin.fail()) {
+            std::cerr << "[ qes ] invalid or truncated binary program \"" << file << "\"." << std::endl;
+            exit(1);
+        }
+    } else {
+        for_each_read_statement(fin, [&] (const block_t& stmt) { for_each_expanded(stmt, f); });
+    }
+}
+
+// Returns true if the blocks differ at most in their repeat counts.
+static bool
+has_same_body(block_t x, const block_t& y) {
+    x.repeat_count = y.repeat_count;
+    return x == y;
+}
+
+static void
+print_flat(std::ostream& out, const Instruction<>& inst) {
+    out << print_inst(inst, false) << "\n";
+}
+
+static int
+run_cat(const std::vector<std::string>& args) {
+    bool compact = false;
+    uint64_t window = DEFAULT_COMPACT_WINDOW;
+    std::optional<std::string> file;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "--compact")                         compact = true;
+        else if (args[i] == "--window" && i+1 < args.size()) window = std::max(parse_count(args[++i]), uint64_t(1));
+        else if (!file.has_value())                         file = args[i];
+        else                                                exit_with_usage();
+    }
+    if (!file.has_value()) exit_with_usage();
+
+    if (!compact) {
+        for_each_instruction(*file, [] (Instruction<>&& inst) { print_flat(std::cout, inst); });
+        return 0;
+    }
+    // The program is rerolled one window at a time. Single instructions at the
+    // end of a window may start a run that continues into the next window, so
+    // they are carried over. Likewise, the last repeat block is held back, so
+    // that it can be merged with an equal one at the start of the next window.
+    Program<> buf;
+    buf.reserve(window);
+    std::optional<block_t> pending;
+    auto emit_pending = [&] () {
+        if (pending.has_value()) std::cout << print_block(*pending) << "\n";
+        pending.reset();
+    };
+    auto emit_block = [&] (const block_t& sub) {
+        if (pending.has_value() && has_same_body(*pending, sub)) {
+            pending->repeat_count += sub.repeat_count;
+            return;
+        }
+        emit_pending();
+        pending = sub;
+    };
+    auto flush = [&] (bool is_last) {
+        block_t top = reroll_program(buf);
+        const size_t n_trailing = top.instructions.size() - (top.subblocks.empty() ? 0 : top.subblock_pos.back());
+        const size_t n_carry = (is_last || n_trailing > window/2) ? 0 : n_trailing;
+        const size_t n_emit = top.instructions.size() - n_carry;
+        size_t j = 0;
+        for (size_t i = 0; i <= n_emit; i++) {
+            for (; j < top.subblocks.size() && top.subblock_pos[j] == i; j++) emit_block(top.subblocks[j]);
+            if (i < n_emit) {
+                emit_pending();
+                print_flat(std::cout, top.instructions[i]);
+            }
+        }
+        buf.erase(buf.begin(), buf.end() - n_carry);
+    };
+    for_each_instruction(*file, [&] (Instruction<>&& inst) {
+        buf.push_back(std::move(inst));
+        if (buf.size() == window) flush(false);
+    });
+    flush(true);
+    emit_pending();
+    return 0;
+}
+
+static int
+run_stats(const std::vector<std::string>& args) {
+    if (args.size() != 1) exit_with_usage();
+    const std::string& file = args[0];
+    program_stats_t stats;
+    if (is_binary_file(file)) {
+        for_each_instruction(file, [&] (Instruction<>&& inst) { add_instruction(stats, inst); });
+    } else {
+        // Repeat blocks are counted without being expanded.
+        IncludeGuard guard(file);
+        compressed_ifstream fin(file);
+        for_each_read_statement(fin, [&] (const block_t& stmt) { stats += program_stats(stmt); });
+    }
+    std::cout << stats << std::endl;
+    return 0;
+}
+
+static int
+run_filter(const std::vector<std::string>& args) {
+    std::optional<std::string> name, file;
+    std::optional<annotation_handle_t> annotation;
+    std::optional<property_handle_t> property;
+    for (size_t i = 0; i < args.size(); i++) {
+        const bool has_value = i+1 < args.size();
+        if (args[i] == "--name" && has_value)               name = to_lower(args[++i]);
+        else if (args[i] == "--annotation" && has_value)    annotation = get_annotation_handle(to_lower(args[++i]));
+        else if (args[i] == "--property" && has_value)      property = get_property_handle(to_lower(args[++i]));
+        else if (!file.has_value())                         file = args[i];
+        else                                                exit_with_usage();
+    }
+    if (!file.has_value()) exit_with_usage();
+    for_each_instruction(*file, [&] (Instruction<>&& inst) {
+        if (name.has_value() && inst.get_name() != *name) return;
+        if (annotation.has_value() && !inst.has_annotation(*annotation)) return;
+        if (property.has_value() && !inst.has_property(*property)) return;
+        print_flat(std::cout, inst);
+    });
+    return 0;
+}
+
+static int
+run_convert(const std::vector<std::string>& args) {
+    if (args.size() != 2) exit_with_usage();
+    const std::string& output = args[1];
+    std::string base = output;
+    for (const char* ext : {".gz", ".zst"}) {
+        if (ends_with(base, ext)) base.erase(base.size() - strlen(ext));
+    }
+    const bool to_binary = ends_with(base, ".qesb");
+
+    compressed_ofstream fout(output);
+    if (to_binary) {
+        write_binary_header(fout);
+        for_each_instruction(args[0], [&] (Instruction<>&& inst) { write_binary_inst(fout, inst); });
+    } else {
+        for_each_instruction(args[0], [&] (Instruction<>&& inst) { print_flat(fout, inst); });
+    }
+    fout.flush();
+    return 0;
+}
+
+// Reads the file without keeping anything. The readers exit on an invalid
+// program, which is why each file is validated in its own process.
+static void
+read_and_discard(const std::string& file) {
+    if (is_binary_file(file)) {
+        for_each_instruction(file, [] (Instruction<>&&) {});
+    } else {
+        IncludeGuard guard(file);
+        compressed_ifstream fin(file);
+        for_each_read_statement(fin, [] (const block_t&) {});
+    }
+}
+
+static int
+run_validate(const std::vector<std::string>& args) {
+    size_t n_jobs = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> files;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "-j" && i+1 < args.size())   n_jobs = std::max(parse_count(args[++i]), uint64_t(1));
+        else                                        files.push_back(args[i]);
+    }
+    if (files.empty()) exit_with_usage();
+
+    std::map<pid_t, size_t> running;
+    std::vector<bool> is_valid(files.size(), false);
+    auto wait_one = [&] () {
+        int status;
+        pid_t pid;
+        do {
+            pid = wait(&status);
+        } while (pid < 0 && errno == EINTR);
+        if (pid < 0) {
+            std::cerr << "[ qes ] could not wait for the validating processes: " << strerror(errno) << std::endl;
+            exit(1);
+        }
+        const size_t k = running.at(pid);
+        running.erase(pid);
+        is_valid[k] = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        std::cout << files[k] << ": " << (is_valid[k] ? "ok" : "invalid") << std::endl;
+    };
+    for (size_t k = 0; k < files.size(); k++) {
+        if (running.size() == n_jobs) wait_one();
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "[ qes ] could not start a process to validate \"" << files[k] << "\"." << std::endl;
+            exit(1);
+        }
+        if (pid == 0) {
+            read_and_discard(files[k]);
+            _exit(0);
+        }
+        running[pid] = k;
+    }
+    while (!running.empty()) wait_one();
+    const size_t n_invalid = std::count(is_valid.begin(), is_valid.end(), false);
+    if (n_invalid > 0) std::cout << n_invalid << " of " << files.size() << " files are invalid." << std::endl;
+    return n_invalid > 0 ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) exit_with_usage();
+    const std::string command(argv[1]);
+    const std::vector<std::string> args(argv+2, argv+argc);
+
+    if (command == "cat")       return run_cat(args);
+    if (command == "stats")     return run_stats(args);
+    if (command == "filter")    return run_filter(args);
+    if (command == "convert")   return run_convert(args);
+    if (command == "validate")  return run_validate(args);
+    exit_with_usage();
+}
@@ -0,0 +1,205 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/binary.h"
+
+#include <algorithm>
+
+#include <string.h>
+
+namespace qes {
+
+static const char BINARY_MAGIC[4] = { 'Q', 'E', 'S', 'B' };
+
+enum { TAG_INT = 0, TAG_DOUBLE = 1, TAG_STRING = 2 };
+
+static void
+write_varint(std::ostream& out, uint64_t x) {
+    char buf[10];
+    int n = 0;
+    while (x >= 0x80) {
+        buf[n++] = static_cast<char>((x & 0x7f) | 0x80);
+        x >>= 7;
+    }
+    buf[n++] = static_cast<char>(x);
+    out.write(buf, n);
+}
+
+static bool
+read_varint(std::istream& in, uint64_t& x) {
+    x = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = in.get();
+        if (c == EOF) return false;
+        x |= static_cast<uint64_t>(c & 0x7f) << shift;
+        if ((c & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+static void
+write_string(std::ostream& out, const std::string& s) {
+    write_varint(out, s.size());
+    out.write(s.data(), s.size());
+}
+
+// Lengths and counts come from the input, which may be corrupt, so nothing is
+// allocated up front beyond this many elements.
+static const uint64_t MAX_PREALLOCATION = 1 << 16;
+
+static bool
+read_string(std::istream& in, std::string& s) {
+    uint64_t n;
+    if (!read_varint(in, n)) return false;
+    s.clear();
+    while (n > 0) {
+        const uint64_t m = std::min(n, MAX_PREALLOCATION);
+        const size_t k = s.size();
+        s.resize(k + m);
+        in.read(s.data() + k, m);
+        if (static_cast<uint64_t>(in.gcount()) != m) return false;
+        n -= m;
+    }
+    return true;
+}
+
+static void
+write_any(std::ostream& out, const any_t& x) {
+    if (holds_alternative<int64_t>(x)) {
+        int64_t v = get<int64_t>(x);
+        out.put(TAG_INT);
+        write_varint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+    } else if (holds_alternative<double>(x)) {
+        double v = get<double>(x);
+        char buf[8];
+        memcpy(buf, &v, 8);
+        out.put(TAG_DOUBLE);
+        out.write(buf, 8);
+    } else {
+        out.put(TAG_STRING);
+        write_string(out, get<std::string>(x));
+    }
+}
+
+static bool
+read_any(std::istream& in, any_t& x) {
+    int tag = in.get();
+    if (tag == TAG_INT) {
+        uint64_t z;
+        if (!read_varint(in, z)) return false;
+        x = static_cast<int64_t>((z >> 1) ^ (~(z & 1) + 1));
+    } else if (tag == TAG_DOUBLE) {
+        char buf[8];
+        double v;
+        in.read(buf, 8);
+        if (in.gcount() != 8) return false;
+        memcpy(&v, buf, 8);
+        x = v;
+    } else if (tag == TAG_STRING) {
+        std::string s;
+        if (!read_string(in, s)) return false;
+        x = std::move(s);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void
+exit_on_bad_binary(void) {
+    std::cerr << "[ qes ] invalid or truncated binary program." << std::endl;
+    exit(1);
+}
+
+static bool
+fail_bad_binary(std::istream& in) {
+    in.setstate(std::ios::failbit);
+    return false;
+}
+
+void
+write_binary_header(std::ostream& out) {
+    out.write(BINARY_MAGIC, 4);
+    write_varint(out, QES_BINARY_FORMAT_VERSION);
+}
+
+void
+write_binary_inst(std::ostream& out, const Instruction<>& inst) {
+    write_string(out, inst.get_name());
+
+    write_varint(out, inst.get_number_of_operands());
+    for (const any_t& x : inst.get_operands()) write_any(out, x);
+
+    auto annotations = inst.get_annotations();
+    write_varint(out, annotations.size());
+    for (const annotation_t& a : annotations) write_string(out, a);
+
+    auto property_map = inst.get_property_map();
+    write_varint(out, property_map.size());
+    for (const auto& [ k, v ] : property_map) {
+        write_string(out, k);
+        write_any(out, v);
+    }
+}
+
+void
+write_binary_program(std::ostream& out, const Program<>& program) {
+    write_binary_header(out);
+    for (const auto& inst : program) write_binary_inst(out, inst);
+}
+
+bool
+read_binary_header(std::istream& in) {
+    char magic[4];
+    in.read(magic, 4);
+    if (in.gcount() != 4 || memcmp(magic, BINARY_MAGIC, 4) != 0) return false;
+    uint64_t version;
+    return read_varint(in, version) && version == QES_BINARY_FORMAT_VERSION;
+}
+
+bool
+read_binary_inst(std::istream& in, Instruction<>& inst) {
+    std::string name;
+    if (in.peek() == EOF) return false;
+    if (!read_string(in, name)) return fail_bad_binary(in);
+
+    uint64_t n;
+    if (!read_varint(in, n)) return fail_bad_binary(in);
+    std::vector<any_t> operands;
+    operands.reserve(std::min(n, MAX_PREALLOCATION));
+    while (n--) {
+        any_t x;
+        if (!read_any(in, x)) return fail_bad_binary(in);
+        operands.push_back(std::move(x));
+    }
+    inst = Instruction<>(name, std::move(operands));
+
+    if (!read_varint(in, n)) return fail_bad_binary(in);
+    while (n--) {
+        std::string a;
+        if (!read_string(in, a)) return fail_bad_binary(in);
+        inst.put(a);
+    }
+    if (!read_varint(in, n)) return fail_bad_binary(in);
+    while (n--) {
+        std::string k;
+        any_t v;
+        if (!read_string(in, k) || !read_any(in, v)) return fail_bad_binary(in);
+        inst.put(k, v);
+    }
+    return true;
+}
+
+Program<>
+read_binary_program(std::istream& in) {
+    if (!read_binary_header(in)) exit_on_bad_binary();
+    Program<> program;
+    Instruction<> inst;
+    while (read_binary_inst(in, inst)) program.push_back(std::move(inst));
+    if (in.fail()) exit_on_bad_binary();
+    return program;
+}
+
+}   // qes
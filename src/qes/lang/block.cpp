@@ -0,0 +1,219 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/block.h"
+#include "qes/lang/fast_parse_impl.h"
+
+#include <algorithm>
+
+namespace qes {
+
+block_t
+read_compressed_program(std::istream& fin) {
+    debug_state_t st = {0, 0};
+    subroutine_table_t subroutines;
+    parse_scope_t scope;
+    scope.subroutines = &subroutines;
+    scope.allow_definitions = true;
+    return read_compressed_block(fin, st, &scope);
+}
+
+static block_t
+read_compressed_body(std::istream& fin, debug_state_t& st, const parse_scope_t* scope,
+        std::vector<source_location_t>* locations, const read_phases_t& phases)
+{
+    block_t blk;
+    parse_state_t p_st;
+    p_st.scope = scope;
+    while (read_statement(fin, st, p_st, blk, locations, phases));
+    return blk;
+}
+
+block_t
+read_compressed_block(std::istream& fin, debug_state_t& st, const parse_scope_t* scope,
+        std::vector<source_location_t>* locations)
+{
+    return read_compressed_body(fin, st, scope, locations, {});
+}
+
+void
+for_each_read_statement(std::istream& fin, std::function<void(const block_t&)> f) {
+    debug_state_t st = {0, 0};
+    subroutine_table_t subroutines;
+    parse_scope_t scope;
+    scope.subroutines = &subroutines;
+    scope.allow_definitions = true;
+    parse_state_t p_st;
+    p_st.scope = &scope;
+    // The statement is read into a scratch block, which keeps its capacity.
+    block_t stmt;
+    while (read_statement(fin, st, p_st, stmt)) {
+        // Definitions do not add a statement.
+        if (!stmt.instructions.empty() || !stmt.subblocks.empty()) f(stmt);
+        stmt.clear();
+    }
+}
+
+bool
+read_compressed_statement(std::istream& fin, debug_state_t& st, block_t& blk, const parse_scope_t* scope,
+        std::vector<source_location_t>* locations)
+{
+    parse_state_t p_st;
+    p_st.scope = scope;
+    return read_statement(fin, st, p_st, blk, locations);
+}
+
+bool
+read_statement(std::istream& fin, debug_state_t& st, parse_state_t& p_st, block_t& blk,
+        std::vector<source_location_t>* locations, const read_phases_t& phases)
+{
+    status_t status = status_t::awaiting_token;
+    // The location of the statement's first token (for an instruction with
+    // modifiers, the location of its name).
+    source_location_t stmt_loc;
+
+    Token tok;
+    while (true) {
+        const debug_state_t tok_st = st;
+        {
+            QES_IF_PROFILE(PhaseTimer timer(phases.tokenize);)
+            tok = read_next_token(fin, st);
+        }
+        const token_type& type = std::get<0>(tok);
+        if (type == T_empty) continue;
+        if (type == T_undefined) return false;
+        if (locations != nullptr && status == status_t::awaiting_token) stmt_loc = get_source_location(tok_st);
+        QES_IF_PROFILE(if (phases.tokenize != nullptr) phases.tokenize->tokens++;)
+        // Parse the token.
+        {
+            QES_IF_PROFILE(PhaseTimer timer(phases.state_machine);)
+            status = parse_token(status, type, std::get<1>(tok), p_st);
+        }
+        // Handle status result.
+        if (status == status_t::invalid) {
+            raise_syntax_error(tok, st);
+        } else if (status == status_t::exit_block) {
+            return false;
+        } else if (status == status_t::enter_subblock) {
+            const parse_scope_t* scope = p_st.scope;
+            parse_scope_t inner = scope == nullptr ? parse_scope_t() : scope->nested();
+            if (!p_st.repeat_var.empty()) inner.loop_vars.push_back(intern_string(p_st.repeat_var));
+            block_t sub = read_compressed_body(fin, st, &inner, locations, phases);
+            if (!p_st.repeat_var.empty()) sub.loop_var = inner.loop_vars.back();
+            sub.repeat_count = p_st.repeat_ctr;
+            blk.subblock_pos.push_back(blk.instructions.size());
+            blk.subblocks.push_back(std::move(sub));
+            p_st.in_repeat_awaiting_ctr_step = 0;
+            return true;
+        } else if (status == status_t::enter_definition) {
+            parse_scope_t inner = get_definition_scope(p_st);
+            define_subroutine(p_st, read_compressed_body(fin, st, &inner, nullptr, phases));
+            return true;
+        } else if (status == status_t::call_subroutine) {
+            blk.subblock_pos.push_back(blk.instructions.size());
+            blk.subblocks.push_back(std::move(p_st.call));
+            if (locations != nullptr) locations->push_back(stmt_loc);
+            return true;
+        } else if (!p_st.program.empty()) {
+            blk.instructions.push_back(std::move(p_st.program.back()));
+            p_st.program.pop_back();
+            QES_IF_PROFILE(if (phases.state_machine != nullptr) phases.state_machine->instructions++;)
+            if (locations != nullptr) locations->push_back(stmt_loc);
+            return true;
+        }
+    }
+}
+
+// Returns the number of instructions in one iteration of the block.
+static uint64_t
+get_period(const block_t& blk) {
+    // The size of a subroutine's body is computed once, when it is defined.
+    if (blk.subroutine != nullptr) return blk.subroutine->expanded_size;
+    uint64_t n = blk.instructions.size();
+    for (const block_t& sub : blk.subblocks) n += get_expanded_size(sub);
+    return n;
+}
+
+uint64_t
+get_expanded_size(const block_t& blk) {
+    return get_period(blk) * std::max(blk.repeat_count, int64_t(0));
+}
+
+static void
+expand_into(const block_t& blk, Program<>& out, loop_context_t& ctx) {
+    if (blk.repeat_count <= 0) return;
+    auto push = [&] (const Instruction<>& inst) {
+        out.push_back(inst);
+        if (!ctx.empty()) evaluate(out.back(), ctx);
+    };
+    auto recurse = [&] (const block_t& sub) { expand_into(sub, out, ctx); };
+    const size_t n_bindings = push_call_bindings(blk, ctx);
+    if (blk.loop_var != block_t::NO_LOOP_VAR) {
+        // Each iteration has different values, so the body is expanded for each.
+        ctx.push_back({blk.loop_var, 0});
+        for (int64_t i = 0; i < blk.repeat_count; i++) {
+            ctx.back().value = i;
+            for_each_statement(blk, push, recurse);
+        }
+        ctx.pop_back();
+    } else {
+        const size_t start = out.size();
+        for_each_statement(blk, push, recurse);
+        // Copy the body for the remaining repeats.
+        const size_t end = out.size();
+        for (int64_t i = 1; i < blk.repeat_count; i++) {
+            for (size_t j = start; j < end; j++) out.push_back(out[j]);
+        }
+    }
+    ctx.resize(ctx.size() - n_bindings);
+}
+
+Program<>
+expand(const block_t& blk, const loop_context_t& ctx) {
+    Program<> out;
+    append_expanded(blk, out, ctx);
+    return out;
+}
+
+void
+append_expanded(const block_t& blk, Program<>& out, const loop_context_t& ctx) {
+    reserve_more(out, get_expanded_size(blk));
+    loop_context_t _ctx(ctx);
+    expand_into(blk, out, _ctx);
+}
+
+void
+expand_range(const block_t& blk, uint64_t begin, uint64_t end, Program<>& out, const loop_context_t& ctx) {
+    const uint64_t period = get_period(blk);
+    end = std::min(end, get_expanded_size(blk));
+    if (begin >= end) return;
+
+    loop_context_t _ctx(ctx);
+    push_call_bindings(blk, _ctx);
+    const bool has_var = blk.loop_var != block_t::NO_LOOP_VAR;
+    if (has_var) _ctx.push_back({blk.loop_var, 0});
+    // Skip all iterations before begin.
+    for (uint64_t base = (begin / period) * period; base < end; base += period) {
+        if (has_var) _ctx.back().value = static_cast<int64_t>(base / period);
+        uint64_t pos = base;
+        for_each_statement(blk,
+            [&] (const Instruction<>& inst) {
+                if (pos >= begin && pos < end) {
+                    out.push_back(inst);
+                    if (!_ctx.empty()) evaluate(out.back(), _ctx);
+                }
+                pos++;
+            },
+            [&] (const block_t& sub) {
+                uint64_t n = get_expanded_size(sub);
+                if (pos < end && pos + n > begin) {
+                    expand_range(sub, begin > pos ? begin - pos : 0, end - pos, out, _ctx);
+                }
+                pos += n;
+            });
+    }
+}
+
+}   // qes
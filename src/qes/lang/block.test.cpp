@@ -0,0 +1,82 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ *
+ *  Fails if a program with subroutines does not read as its plain expansion,
+ *  with either reader or through a compressed program (see
+ *  qes/lang/block.h).
+ * */
+
+#include <qes.h>
+#include <qes/lang/block.h>
+
+#include <sstream>
+#include <utility>
+#include <vector>
+
+using namespace qes;
+
+// Each program, and the same program written without subroutines.
+std::vector<std::pair<std::string, std::string>>
+make_test_programs() {
+    std::vector<std::pair<std::string, std::string>> programs = {
+        { "def f(a) { x a; y a+1; } call f(3); call f(0);",
+            "x 3; y 4; x 0; y 1;" },
+        { "def h() { h 0; } repeat (2) { call h(); } call h();",
+            "h 0; h 0; h 0;" },
+        { "def f(a) { x a; } repeat (i, 3) { call f(i*i); }",
+            "x 0; x 1; x 4;" },
+        // Subroutines may call the subroutines defined before them.
+        { "def f(a) { x a; } def g(a, b) { call f(a*b); repeat (i, 2) { call f(a+i); } } call g(2, 3);",
+            "x 6; x 2; x 3;" },
+        { "def a(p) { x p; } def b(p) { call a(p); call a(-p); } def c(p) { repeat (i, 2) { call b(p+i); } }"
+            " call c(10); repeat (j, 2) { call b(j); }",
+            "x 10; x -10; x 11; x -11; x 0; x 0; x 1; x -1;" },
+        // Parameters may appear in properties.
+        { "def f(a) { @property round (a) @annotation last\nx a; } call f(5);",
+            "@property round 5\n@annotation last\nx 5;" },
+        { "def e() { } call e(); def z() { repeat (0) { x 1; } } call z(); x 1;",
+            "x 1;" },
+        // call is an ordinary instruction unless it is followed by name(.
+        { "call 1, 2;",
+            "call 1, 2;" }
+    };
+    // A subroutine called many times, with arguments from two loops.
+    std::ostringstream flat;
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < 10; j++) flat << "cx " << i << ", " << j << "; h " << i+j << ";\n";
+    }
+    programs.push_back({ "def f(a, b) { cx a, b; h a+b; }\n"
+                            "repeat (i, 10) { repeat (j, 10) { call f(i, j); } }", flat.str() });
+    return programs;
+}
+
+bool
+check(std::string name, const Program<>& program, const Program<>& expected, size_t k) {
+    if (program == expected) return true;
+    std::cerr << "[ qes ] " << name << " does not match the expansion of program " << k << "." << std::endl;
+    return false;
+}
+
+int main() {
+    const auto programs = make_test_programs();
+    bool ok = true;
+    for (size_t k = 0; k < programs.size(); k++) {
+        const auto& [ text, flat ] = programs[k];
+        std::istringstream flat_in(flat);
+        const Program<> expected = fast_read_program(flat_in);
+
+        std::istringstream in(text);
+        ok &= check("fast_read_program", fast_read_program(in), expected, k);
+        in = std::istringstream(text);
+        ok &= check("safe_read_program", safe_read_program(in), expected, k);
+        in = std::istringstream(text);
+        const block_t blk = read_compressed_program(in);
+        ok &= check("read_compressed_program", expand(blk), expected, k);
+        if (get_expanded_size(blk) != expected.size()) {
+            std::cerr << "[ qes ] the expanded size of program " << k << " is wrong." << std::endl;
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,279 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/expression.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace qes {
+
+namespace {
+
+// A recursive descent parser over the tokens:
+//      expr    = term (("+" | "-") term)*
+//      term    = factor (("*" | "/" | "%") factor)*
+//      factor  = I_LITERAL | IDENTIFIER | "(" expr ")" | "-" factor
+struct expr_parser_t {
+    const std::vector<Token>&   tokens;
+    size_t                      pos;
+    expr_t&                     out;
+
+    bool
+    at(std::string type) const {
+        return pos < tokens.size() && std::get<0>(tokens[pos]) == type;
+    }
+
+    bool
+    parse_expr() {
+        if (!parse_term()) return false;
+        while (at("+") || at("-")) {
+            expr_op_t::kind_t k = at("+") ? expr_op_t::ADD : expr_op_t::SUB;
+            pos++;
+            if (!parse_term()) return false;
+            out.push_back({k, 0});
+        }
+        return true;
+    }
+
+    bool
+    parse_term() {
+        if (!parse_factor()) return false;
+        while (at("*") || at("/") || at("%")) {
+            expr_op_t::kind_t k = at("*") ? expr_op_t::MUL : (at("/") ? expr_op_t::DIV : expr_op_t::MOD);
+            pos++;
+            if (!parse_factor()) return false;
+            out.push_back({k, 0});
+        }
+        return true;
+    }
+
+    bool
+    parse_factor() {
+        if (at("I_LITERAL")) {
+            out.push_back({expr_op_t::CONST, std::stoll(std::get<1>(tokens[pos++]))});
+        } else if (at("IDENTIFIER")) {
+            out.push_back({expr_op_t::VAR, intern_string(std::get<1>(tokens[pos++]))});
+        } else if (at("(")) {
+            pos++;
+            if (!parse_expr() || !at(")")) return false;
+            pos++;
+        } else if (at("-")) {
+            pos++;
+            if (!parse_factor()) return false;
+            out.push_back({expr_op_t::NEG, 0});
+        } else {
+            return false;
+        }
+        return true;
+    }
+};
+
+}   // anonymous
+
+void
+retain_expression(const shared_expr_t* e) {
+    e->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+release_expression(const shared_expr_t* e) {
+    if (e->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete e;
+}
+
+std::string
+print_expression(const shared_expr_t* e) {
+    return print_expression(e->expr);
+}
+
+bool
+parse_expression(const std::vector<Token>& tokens, expr_t& out) {
+    out.clear();
+    expr_parser_t p{tokens, 0, out};
+    return p.parse_expr() && p.pos == tokens.size();
+}
+
+bool
+all_variables_bound(const expr_t& e, const std::vector<uint32_t>& loop_vars) {
+    for (const expr_op_t& op : e) {
+        if (op.kind != expr_op_t::VAR) continue;
+        bool found = false;
+        for (uint32_t v : loop_vars) found |= (v == op.value);
+        if (!found) return false;
+    }
+    return true;
+}
+
+bool
+uses_variables(const expr_t& e) {
+    for (const expr_op_t& op : e) {
+        if (op.kind == expr_op_t::VAR) return true;
+    }
+    return false;
+}
+
+any_t
+make_expression_value(expr_t e) {
+    if (!uses_variables(e)) return evaluate(e, {});
+    return any_t(new shared_expr_t{{1}, std::move(e)});
+}
+
+// Applies the operator to a and b (or to a, for NEG). Exits on a division by
+// zero or an overflow.
+static int64_t
+apply(expr_op_t::kind_t k, int64_t a, int64_t b, const expr_t& e) {
+    int64_t out;
+    bool overflow;
+    if (k == expr_op_t::ADD)        overflow = __builtin_add_overflow(a, b, &out);
+    else if (k == expr_op_t::SUB)   overflow = __builtin_sub_overflow(a, b, &out);
+    else if (k == expr_op_t::MUL)   overflow = __builtin_mul_overflow(a, b, &out);
+    else if (k == expr_op_t::NEG)   overflow = __builtin_sub_overflow(int64_t(0), a, &out);
+    else {
+        if (b == 0) {
+            std::cerr << "[ qes ] division by zero in \"" << print_expression(e) << "\"." << std::endl;
+            exit(1);
+        }
+        // INT64_MIN / -1 is the only quotient that does not fit (and
+        // INT64_MIN % -1 is undefined in C++, though it is 0).
+        overflow = (a == INT64_MIN && b == -1 && k == expr_op_t::DIV);
+        if (a == INT64_MIN && b == -1)  out = 0;
+        else if (k == expr_op_t::DIV)   out = a / b;
+        else                            out = a % b;
+    }
+    if (overflow) {
+        std::cerr << "[ qes ] integer overflow in \"" << print_expression(e) << "\"." << std::endl;
+        exit(1);
+    }
+    return out;
+}
+
+int64_t
+evaluate(const expr_t& e, const loop_context_t& ctx) {
+    // Expressions are small, so a fixed-size stack usually suffices.
+    int64_t small_stack[16];
+    std::vector<int64_t> big_stack;
+    int64_t* stack = small_stack;
+    if (e.size() > 16) {
+        big_stack.resize(e.size());
+        stack = big_stack.data();
+    }
+    size_t n = 0;
+    for (const expr_op_t& op : e) {
+        if (op.kind == expr_op_t::CONST) {
+            stack[n++] = op.value;
+        } else if (op.kind == expr_op_t::VAR) {
+            // The innermost binding of the variable wins.
+            auto it = ctx.rbegin();
+            while (it != ctx.rend() && it->var != op.value) it++;
+            if (it == ctx.rend()) {
+                std::cerr << "[ qes ] loop variable \"" << get_interned_string(op.value)
+                    << "\" is not defined." << std::endl;
+                exit(1);
+            }
+            stack[n++] = it->value;
+        } else if (op.kind == expr_op_t::NEG) {
+            stack[n-1] = apply(op.kind, stack[n-1], 0, e);
+        } else {
+            const int64_t b = stack[--n];
+            stack[n-1] = apply(op.kind, stack[n-1], b, e);
+        }
+    }
+    return stack[0];
+}
+
+// Returns -x, or INT64_MAX if -x does not fit.
+static int64_t
+negate_saturated(int64_t x) {
+    return x == INT64_MIN ? INT64_MAX : -x;
+}
+
+std::pair<int64_t, int64_t>
+get_range(const expr_t& e, const std::vector<var_range_t>& ranges) {
+    std::vector<std::pair<int64_t, int64_t>> stack;
+    for (const expr_op_t& op : e) {
+        if (op.kind == expr_op_t::CONST) {
+            stack.emplace_back(op.value, op.value);
+        } else if (op.kind == expr_op_t::VAR) {
+            // The innermost range of the variable is used.
+            auto r = std::find_if(ranges.rbegin(), ranges.rend(), [&] (auto& r) { return r.var == op.value; });
+            if (r == ranges.rend()) {
+                evaluate(e, {});    // This exits with an error.
+            }
+            stack.emplace_back(r->lo, r->hi);
+        } else if (op.kind == expr_op_t::NEG) {
+            stack.back() = { apply(op.kind, stack.back().second, 0, e), apply(op.kind, stack.back().first, 0, e) };
+        } else {
+            auto [ blo, bhi ] = stack.back();
+            stack.pop_back();
+            auto& [ alo, ahi ] = stack.back();
+            if (op.kind == expr_op_t::ADD) {
+                alo = apply(op.kind, alo, blo, e);
+                ahi = apply(op.kind, ahi, bhi, e);
+            } else if (op.kind == expr_op_t::SUB) {
+                alo = apply(op.kind, alo, bhi, e);
+                ahi = apply(op.kind, ahi, blo, e);
+            } else if (op.kind == expr_op_t::MUL || (op.kind == expr_op_t::DIV && (blo > 0 || bhi < 0))) {
+                // Both are monotonic in each argument (for a divisor of
+                // fixed sign), so the extremes are at the endpoints.
+                int64_t p[] = { apply(op.kind, alo, blo, e), apply(op.kind, alo, bhi, e),
+                                apply(op.kind, ahi, blo, e), apply(op.kind, ahi, bhi, e) };
+                alo = *std::min_element(p, p+4);
+                ahi = *std::max_element(p, p+4);
+            } else if (blo == 0 && bhi == 0) {
+                apply(op.kind, alo, 0, e);  // This exits with an error.
+            } else if (op.kind == expr_op_t::DIV) {
+                // The divisor may be 0, but otherwise |a/b| <= |a|.
+                const int64_t lo = std::min(alo, negate_saturated(ahi)),
+                              hi = std::max(ahi, negate_saturated(alo));
+                alo = lo;
+                ahi = hi;
+            } else {
+                // a % b has the sign of a, and |a % b| < |b| and |a % b| <= |a|.
+                // So for a constant m > 0 and a >= 0, a % m is in
+                // [0, min(m-1, a)].
+                const int64_t m = (blo == INT64_MIN) ? INT64_MAX : std::max(-blo, bhi) - 1;
+                alo = alo < 0 ? std::max(alo, -m) : 0;
+                ahi = ahi > 0 ? std::min(ahi, m) : 0;
+            }
+        }
+    }
+    return stack[0];
+}
+
+any_t
+substitute(const any_t& x, uint32_t var, int64_t value) {
+    if (!is_expression_ref(x)) return x;
+    expr_t e = get_expression(x);
+    for (expr_op_t& op : e) {
+        if (op.kind == expr_op_t::VAR && op.value == var) op = {expr_op_t::CONST, value};
+    }
+    return make_expression_value(std::move(e));
+}
+
+std::string
+print_expression(const expr_t& e) {
+    // Rebuild the infix expression (fully parenthesized, except at the top).
+    std::vector<std::string> stack;
+    for (const expr_op_t& op : e) {
+        if (op.kind == expr_op_t::CONST) {
+            stack.push_back(std::to_string(op.value));
+        } else if (op.kind == expr_op_t::VAR) {
+            stack.push_back(get_interned_string(op.value));
+        } else if (op.kind == expr_op_t::NEG) {
+            stack.back() = "-" + stack.back();
+        } else {
+            const char* sym = "+-*/%";
+            std::string b = std::move(stack.back());
+            stack.pop_back();
+            stack.back() = "(" + stack.back() + sym[op.kind - expr_op_t::ADD] + b + ")";
+        }
+    }
+    std::string out = stack.empty() ? "" : stack.back();
+    if (out.size() > 1 && out.front() == '(' && out.back() == ')') out = out.substr(1, out.size()-2);
+    return out;
+}
+
+}   // qes
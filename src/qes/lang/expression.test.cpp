@@ -0,0 +1,151 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ *
+ *  Fails if a program with loop variables and expressions (see
+ *  qes/lang/expression.h) does not read as its plain expansion, with either
+ *  reader or through a compressed program, or if the stats of the compressed
+ *  program do not match (see qes/lang/stats.h).
+ * */
+
+#include <qes.h>
+#include <qes/lang/block.h>
+#include <qes/lang/stats.h>
+
+#include <functional>
+#include <map>
+#include <random>
+#include <sstream>
+
+using namespace qes;
+
+const size_t N_PROGRAMS = 40;
+
+typedef std::map<std::string, int64_t> env_t;
+
+// An expression, as written and as a function of the loop variables.
+struct test_expr_t {
+    std::string                             text;
+    std::function<int64_t(const env_t&)>    value;
+};
+
+test_expr_t
+make_expr(std::mt19937& rng, const std::vector<std::string>& vars, int depth) {
+    const uint32_t k = depth == 0 ? rng() % 2 : rng() % 7;
+    if (k == 0 || vars.empty()) {
+        const int64_t c = static_cast<int64_t>(rng() % 7) - 2;
+        return { std::to_string(c), [c] (const env_t&) { return c; } };
+    } else if (k == 1) {
+        const std::string v = vars[rng() % vars.size()];
+        return { v, [v] (const env_t& env) { return env.at(v); } };
+    }
+    test_expr_t a = make_expr(rng, vars, depth-1);
+    if (k == 2) return { "-(" + a.text + ")", [a] (const env_t& env) { return -a.value(env); } };
+    // Divisors are positive constants.
+    if (k == 5 || k == 6) {
+        const int64_t c = 1 + rng() % 4;
+        if (k == 5) return { "(" + a.text + ")/" + std::to_string(c), [a, c] (const env_t& env) { return a.value(env) / c; } };
+        else        return { "(" + a.text + ")%" + std::to_string(c), [a, c] (const env_t& env) { return a.value(env) % c; } };
+    }
+    test_expr_t b = make_expr(rng, vars, depth-1);
+    const char op = "+-*"[k-3];
+    return { "(" + a.text + ")" + op + "(" + b.text + ")",
+        [a, b, op] (const env_t& env) {
+            const int64_t x = a.value(env), y = b.value(env);
+            return op == '+' ? x+y : (op == '-' ? x-y : x*y);
+        } };
+}
+
+// Writes n statements, both with loops (to `out`) and expanded (to `flat`).
+// Each loop is written once, with its expansion as a function of the loop
+// variables.
+void
+write_statements(std::ostream& out, std::vector<std::function<void(std::ostream&, env_t&)>>& flat,
+        std::mt19937& rng, std::vector<std::string> vars, size_t n, int depth)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (depth > 0 && rng() % 3 == 0) {
+            const int64_t count = rng() % 4;
+            const bool has_var = rng() % 4 != 0;
+            const std::string var = "i" + std::to_string(vars.size());
+            out << "repeat (";
+            if (has_var) out << var << ", ";
+            out << count << ") {\n";
+            std::vector<std::string> inner(vars);
+            if (has_var) inner.push_back(var);
+            std::vector<std::function<void(std::ostream&, env_t&)>> body;
+            write_statements(out, body, rng, inner, 1 + rng() % 3, depth-1);
+            out << "}\n";
+            flat.push_back([=] (std::ostream& fout, env_t& env) {
+                for (int64_t j = 0; j < count; j++) {
+                    if (has_var) env[var] = j;
+                    for (auto& f : body) f(fout, env);
+                }
+                if (has_var) env.erase(var);
+            });
+        } else {
+            const bool has_property = rng() % 3 == 0;
+            test_expr_t p = make_expr(rng, vars, 2);
+            std::vector<test_expr_t> operands;
+            for (size_t j = 0; j < 1 + rng() % 3; j++) operands.push_back(make_expr(rng, vars, 2));
+
+            if (has_property) out << "@property round (" << p.text << ")\n";
+            out << "x";
+            for (size_t j = 0; j < operands.size(); j++) out << (j ? ", " : " ") << operands[j].text;
+            out << ";\n";
+            flat.push_back([=] (std::ostream& fout, env_t& env) {
+                if (has_property) fout << "@property round " << p.value(env) << "\n";
+                fout << "x";
+                for (size_t j = 0; j < operands.size(); j++) fout << (j ? ", " : " ") << operands[j].value(env);
+                fout << ";\n";
+            });
+        }
+    }
+}
+
+bool
+check(std::string name, const Program<>& program, const Program<>& expected, size_t seed) {
+    if (program == expected) return true;
+    std::cerr << "[ qes ] " << name << " does not match the expansion of program " << seed << "." << std::endl;
+    return false;
+}
+
+int main() {
+    bool ok = true;
+    for (size_t i = 0; i < N_PROGRAMS && ok; i++) {
+        std::mt19937 rng(i);
+        std::ostringstream out;
+        std::vector<std::function<void(std::ostream&, env_t&)>> flat;
+        write_statements(out, flat, rng, {}, 6, 3);
+        std::ostringstream fout;
+        env_t env;
+        for (auto& f : flat) f(fout, env);
+
+        const std::string text = out.str();
+        std::istringstream flat_in(fout.str());
+        const Program<> expected = fast_read_program(flat_in);
+
+        std::istringstream in(text);
+        ok &= check("fast_read_program", fast_read_program(in), expected, i);
+        in = std::istringstream(text);
+        ok &= check("safe_read_program", safe_read_program(in), expected, i);
+        in = std::istringstream(text);
+        const block_t blk = read_compressed_program(in);
+        ok &= check("read_compressed_program", expand(blk), expected, i);
+
+        // The stats of the block bound the largest operand from above, and
+        // are otherwise exact.
+        program_stats_t stats = program_stats(blk);
+        const program_stats_t expected_stats = program_stats(expected);
+        if (stats.max_qubit < expected_stats.max_qubit) {
+            std::cerr << "[ qes ] the stats of program " << i << " do not bound its largest operand." << std::endl;
+            ok = false;
+        }
+        stats.max_qubit = expected_stats.max_qubit;
+        if (stats != expected_stats) {
+            std::cerr << "[ qes ] the stats of program " << i << " do not match its expansion." << std::endl;
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -3,97 +3,142 @@
  *  date:   5 March 2024
  * */
 
+#include "qes/lang/block.h"
 #include "qes/lang/fast_parse.h"
 #include "qes/lang/fast_parse_impl.h"
+#include "qes/lang/qubit_index.h"
+#include "qes/lang/source_map.h"
 
 #include <ctype.h>
 
 namespace qes {
 
-inline void
-raise_syntax_error(Token tok, const debug_state_t& st) {
-    std::cerr << "[ qes ] found invalid token \"" << std::get<1>(tok) << "\" of type "
-        << std::get<0>(tok) << " at " << st << std::endl;
-    exit(1);
+Program<>
+fast_read_program(std::istream& fin, io_stats_t* stats) {
+    debug_state_t st = {0, 0};
+    Program<> program = read_block(fin, st, stats);
+    QES_IF_PROFILE(
+        if (stats != nullptr) stats->get("tokenize").bytes += st.bytes;
+    )
+    return program;
 }
 
 Program<>
-fast_read_program(std::istream& fin) {
+fast_read_program(std::istream& fin, QubitIndex& qubits, io_stats_t* stats) {
+    debug_state_t st = {0, 0};
+    Program<> program = read_block(fin, st, stats, nullptr, &qubits);
+    qubits.compact();
+    QES_IF_PROFILE(
+        if (stats != nullptr) stats->get("tokenize").bytes += st.bytes;
+    )
+    return program;
+}
+
+Program<>
+fast_read_program(std::istream& fin, SourceMap& locations, io_stats_t* stats) {
+    debug_state_t st = {0, 0};
+    Program<> program = read_block(fin, st, stats, nullptr, nullptr, &locations);
+    QES_IF_PROFILE(
+        if (stats != nullptr) stats->get("tokenize").bytes += st.bytes;
+    )
+    return program;
+}
+
+pmr::Program<>
+fast_read_program(std::istream& fin, std::pmr::memory_resource* mem) {
+    pmr::Program<> program(mem);
     debug_state_t st = {0, 0};
-    return read_block(fin, st);
+    subroutine_table_t subroutines;
+    parse_scope_t scope;
+    scope.subroutines = &subroutines;
+    scope.allow_definitions = true;
+    parse_state_t p_st;
+    p_st.scope = &scope;
+    // Each statement is read into a scratch block, which keeps its capacity.
+    block_t stmt;
+    while (read_statement(fin, st, p_st, stmt)) {
+        if (stmt.subblocks.empty()) {
+            for (const Instruction<>& inst : stmt.instructions) program.emplace_back(inst);
+        } else {
+            for_each_expanded(stmt, [&] (Instruction<>&& inst) { program.emplace_back(inst); });
+        }
+        stmt.clear();
+    }
+    return program;
+}
+
+// Appends the locations of the expanded block, given the locations of its
+// instructions and calls (see read_compressed_block). k is the position of the
+// block's first statement in stmt_locs, and is moved past its last.
+static void
+locate_expanded(const block_t& blk, const std::vector<source_location_t>& stmt_locs, size_t& k, SourceMap& out) {
+    SourceMap body;
+    size_t j = 0;
+    for (size_t i = 0; i <= blk.instructions.size(); i++) {
+        for (; j < blk.subblocks.size() && blk.subblock_pos[j] == i; j++) {
+            const block_t& sub = blk.subblocks[j];
+            if (sub.subroutine != nullptr)  body.push(stmt_locs[k++], get_expanded_size(sub));
+            else                            locate_expanded(sub, stmt_locs, k, body);
+        }
+        if (i < blk.instructions.size()) body.push(stmt_locs[k++]);
+    }
+    for (int64_t r = 0; r < blk.repeat_count; r++) out.append(body, r);
 }
 
 Program<>
-read_block(std::istream& fin, debug_state_t& st) {
-    status_t status = status_t::awaiting_token;
+read_block(std::istream& fin, debug_state_t& st, io_stats_t* stats, const parse_scope_t* scope,
+        QubitIndex* qubits, SourceMap* locations)
+{
+    // The top level owns the subroutines of the program.
+    subroutine_table_t subroutines;
+    parse_scope_t top_scope;
+    if (scope == nullptr) {
+        top_scope.subroutines = &subroutines;
+        top_scope.allow_definitions = true;
+        scope = &top_scope;
+    }
     parse_state_t p_st;
+    p_st.scope = scope;
+    const read_phases_t phases = get_read_phases(stats);
 
-    Token tok;
-    do {
-        tok = read_next_token(fin, st);
-        token_type token_type = std::get<0>(tok);
-        std::string token_val = std::get<1>(tok);
-        if (token_type == T_empty) continue;
-        if (token_type == T_undefined) break;
-        // Parse the token.
-        if (status == status_t::awaiting_token) {
-            status = parse_awaiting_token(token_type, token_val, p_st);
-        } else if (status == status_t::in_instruction) {
-            status = parse_in_instruction(token_type, token_val, p_st);
-        } else if (status == status_t::awaiting_modifier) {
-            status = parse_awaiting_modifier(token_type, p_st);
-        } else if (status == status_t::in_annotation) {
-            status = parse_in_annotation(token_type, token_val, p_st);
-        } else if (status == status_t::in_property) {
-            status = parse_in_property(token_type, token_val, p_st);
-        } else if (status == status_t::in_label) {
-            status = parse_in_label(token_type, token_val, p_st);
-        } else if (status == status_t::in_repeat) {
-            status = parse_in_repeat(token_type, token_val, p_st);
+    Program<> program;
+    // Each statement is read into a scratch block, which keeps its capacity,
+    // and is then expanded into the program.
+    block_t stmt;
+    std::vector<source_location_t> stmt_locs;
+    while (read_statement(fin, st, p_st, stmt, locations == nullptr ? nullptr : &stmt_locs, phases)) {
+        if (stmt.subblocks.empty()) {
+            for (Instruction<>& inst : stmt.instructions) program.push_back(std::move(inst));
+        } else {
+            QES_IF_PROFILE(
+                PhaseTimer repeat_timer(phases.repeat_expansion);
+                if (phases.repeat_expansion != nullptr) phases.repeat_expansion->instructions += get_expanded_size(stmt);
+            )
+            append_expanded(stmt, program);
         }
-        // Handle status result.
-        if (status == status_t::invalid) {
-            raise_syntax_error(tok, st);
-        } else if (status == status_t::exit_block) {
-            break;
-        } else if (status == status_t::enter_subblock) {
-            Program<> blk = read_block(fin, st);
-            // Push back blk as many times as specified by repeat.
-            while (p_st.repeat_ctr--) {
-                p_st.program.insert(p_st.program.end(), blk.begin(), blk.end());
+        // A call is located at the statement, like an instruction.
+        if (!stmt_locs.empty()) {
+            if (stmt.subblocks.empty() || stmt.subblocks[0].subroutine != nullptr) {
+                locations->push(stmt_locs[0], get_expanded_size(stmt));
+            } else {
+                size_t k = 0;
+                locate_expanded(stmt.subblocks[0], stmt_locs, k, *locations);
             }
-            status = status_t::awaiting_token;
+            stmt_locs.clear();
         }
-    } while (std::get<0>(tok) != T_undefined);
-    return p_st.program;
+        if (qubits != nullptr) qubits->update(program);
+        stmt.clear();
+    }
+    return program;
 }
 
 Token
 read_next_token(std::istream& fin, debug_state_t& st) {
-    const std::set<char> SPECIAL_CHARS{
-        ',', ':', ';', '(', ')', '{', '}', '@'
-    };
-    const std::set<std::string> KEYWORDS{
-        "repeat",
-        "annotation",
-        "property"
-    };
-
-    const int found_none = 0,
-                found_identifier = 2,
-                found_integer = 3,
-                found_float = 4,
-                found_string = 5,
-                found_comment = 6;
-
-    int status = found_none;
-    std::string token_type = T_empty;
-    std::string tok;
-    while (!fin.eof()) {
+    Tokenizer t;
+    while (true) {
         char c = fin.get();
-        if (fin.eof()) {
-            return std::make_tuple(T_undefined, "");
-        }
+        if (fin.eof()) return std::make_tuple(T_undefined, "");
+        st.bytes++;
         // Update the debug state:
         if (c == '\n') {
             st.line++;
@@ -101,67 +146,81 @@ read_next_token(std::istream& fin, debug_state_t& st) {
         } else {
             st.col++;
         }
-        // Just keep consuming characters if there is a comment. Only
-        // stop when we find a newline.
-        if (status == found_comment) {
-            if (c == '\n') break;
-            else continue;
-        }
-        // Prioritize string literals, which match anything between their quotes.
-        if (status == found_string) {
-            tok.push_back(c);
-            if (c == '\"') {
-                break;
-            }
-        } else if ((isalpha(c) || c == '_') && status == found_none) {
-            if (isupper(c)) c += 'a' - 'A';
-            tok.push_back(c);
-            token_type = "IDENTIFIER";
-            status = found_identifier;
-        } else if ((isalpha(c) || isdigit(c) || c == '_') && status == found_identifier) {
-            tok.push_back(c);
-        } else if (isdigit(c) && 
-                (status == found_none || status == found_integer || status == found_float)) 
-        {
-            tok.push_back(c);
-            if (status == found_none) {
-                token_type = "I_LITERAL";
-                status = found_integer;
-            }
-        } else if (status == found_none && c == '\"') {
-            tok.push_back(c);
-            token_type = "S_LITERAL";
-            status = found_string;
-        } else if (isspace(c)) {
-            break;
-        } else if (c == '#') {
-            status = found_comment;
-        } else if (c == '.' && (status == found_none || status == found_integer)) {
-            tok.push_back(c);
-            token_type = "F_LITERAL";
-            status = found_float;
-        } else if (status == found_none && SPECIAL_CHARS.count(c)) {
-            token_type = std::string{c};
-            break;
-        } else {
-            // If we find a character that does not match the current token type,
-            // then place back the char and exit.
-            if (status == found_none) {
-                std::cerr << "[ qes ] invalid character \'" << c << "\'(" << (c+0) 
-                    << ") detected at " << st << std::endl;
-                exit(1);
-            }
+        Tokenizer::scan_t r = t.scan(c, st);
+        if (r == Tokenizer::scan_t::more) continue;
+        // Place back a character that does not belong to the token.
+        if (r == Tokenizer::scan_t::end_before) {
             fin.unget();
-            break;
+            st.bytes--;
+            st.col--;
         }
+        return t.take();
     }
-    if (fin.eof()) return std::make_tuple(T_undefined, "");
-    // Post process the information. If we found a keyword, then set the
-    // token type accordingly.
-    if (KEYWORDS.count(tok)) {
-        token_type = tok;
+}
+
+Tokenizer::scan_t
+Tokenizer::scan(char c, const debug_state_t& st) {
+    // Just keep consuming characters if there is a comment. Only stop when we
+    // find a newline.
+    if (status == found_t::comment) {
+        return c == '\n' ? scan_t::end : scan_t::more;
     }
-    return std::make_tuple(token_type, tok);
+    // Prioritize string literals, which match anything between their quotes.
+    if (status == found_t::string) {
+        tok.push_back(c);
+        return c == '\"' ? scan_t::end : scan_t::more;
+    } else if ((isalpha(c) || c == '_') && status == found_t::none) {
+        if (isupper(c)) c += 'a' - 'A';
+        tok.push_back(c);
+        type = "IDENTIFIER";
+        status = found_t::identifier;
+    } else if ((isalpha(c) || isdigit(c) || c == '_') && status == found_t::identifier) {
+        tok.push_back(c);
+    } else if (isdigit(c)
+            && (status == found_t::none || status == found_t::integer || status == found_t::floating))
+    {
+        tok.push_back(c);
+        if (status == found_t::none) {
+            type = "I_LITERAL";
+            status = found_t::integer;
+        }
+    } else if (status == found_t::none && c == '\"') {
+        tok.push_back(c);
+        type = "S_LITERAL";
+        status = found_t::string;
+    } else if (isspace(c)) {
+        return scan_t::end;
+    } else if (c == '#') {
+        status = found_t::comment;
+    } else if (c == '.' && (status == found_t::none || status == found_t::integer)) {
+        tok.push_back(c);
+        type = "F_LITERAL";
+        status = found_t::floating;
+    } else if (status == found_t::none && is_special_char(c)) {
+        type = std::string{c};
+        return scan_t::end;
+    } else {
+        // If we find a character that does not match the current token type,
+        // then the token ends before it.
+        if (status == found_t::none) {
+            std::cerr << "[ qes ] invalid character \'" << c << "\'(" << (c+0)
+                << ") detected at " << st << std::endl;
+            exit(1);
+        }
+        return scan_t::end_before;
+    }
+    return scan_t::more;
+}
+
+Token
+Tokenizer::take() {
+    // If we found a keyword, then set the token type accordingly.
+    if (is_keyword(tok)) type = tok;
+    Token out = std::make_tuple(std::move(type), std::move(tok));
+    type = T_empty;
+    tok.clear();
+    status = found_t::none;
+    return out;
 }
 
 }   // qes
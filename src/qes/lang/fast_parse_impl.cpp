@@ -3,10 +3,118 @@
  *  date:   5 March 2024
  * */
 
+#include "qes/lang/expression.h"
 #include "qes/lang/fast_parse_impl.h"
+#include "qes/lang/module.h"
+
+#include <algorithm>
 
 namespace qes {
 
+static bool get_token_value(const std::vector<Token>&, const parse_state_t&, any_t&);
+
+// Returns true if the instruction read so far starts a call to a subroutine:
+//      call name(args);
+// Otherwise, call is an ordinary instruction.
+static bool
+is_call_prefix(const parse_state_t& st) {
+    const std::vector<Token>& t = st.expr_tokens;
+    return st.inst_name == "call" && st.inst_operands.empty()
+        && t.size() >= 2 && std::get<0>(t[0]) == "IDENTIFIER" && std::get<0>(t[1]) == "(";
+}
+
+static bool
+is_call(const parse_state_t& st) {
+    return is_call_prefix(st) && std::get<0>(st.expr_tokens.back()) == ")";
+}
+
+// Returns false if the token cannot come next in the operand or property value
+// being read (in st.expr_tokens). Tokens are checked as they are read, so that
+// a syntax error is reported at the offending token rather than at the end of
+// the value.
+static bool
+can_extend_value(const std::string& type, const std::string& val, const parse_state_t& st) {
+    const std::vector<Token>& t = st.expr_tokens;
+    const bool starts_call = st.inst_name == "call" && st.inst_operands.empty();
+    // The name of a call is the only identifier that is not a variable.
+    if (type == "IDENTIFIER" && !(starts_call && t.empty())) {
+        if (st.scope == nullptr) return false;
+        const std::vector<uint32_t>& vars = st.scope->loop_vars;
+        if (std::find(vars.begin(), vars.end(), intern_string(val)) == vars.end()) return false;
+    }
+    if (t.empty()) return type != ")" && (is_value_token(type) || type == "(" || type == "-");
+    const std::string& prev = std::get<0>(t.back());
+    // After a value (e.g., "1" or ")"), only an operator, ")", or (between the
+    // arguments of a call) "," can come.
+    const bool after_value = prev == ")" || is_value_token(prev);
+    if (is_value_token(type))   return !after_value;
+    if (type == "(")            return !after_value || (starts_call && t.size() == 1);
+    if (type == "-")            return true;
+    if (type == ")")            return after_value || (starts_call && t.size() == 2 && prev == "(");
+    return after_value;     // A binary operator or ",".
+}
+
+// Returns true if the value is an integer, or an expression (which is always
+// an integer).
+static bool
+is_integer_value(const any_t& x) {
+    return holds_alternative<int64_t>(x) || is_expression_ref(x);
+}
+
+// Converts the tokens of a call into st.call. Returns false if they are not a
+// valid call.
+static bool
+finish_call(parse_state_t& st) {
+    if (st.annotations.size() || st.property_map.size()) return false;
+
+    const std::vector<Token>& t = st.expr_tokens;
+    std::string name = std::get<1>(t[0]);
+    // Split the arguments on the commas outside of parentheses. The parenthesis
+    // after the name must be closed by the last token.
+    std::vector<any_t> args;
+    std::vector<Token> arg;
+    int depth = 0;
+    for (size_t i = 2; i+1 < t.size(); i++) {
+        const std::string& type = std::get<0>(t[i]);
+        if (type == "(") depth++;
+        if (type == ")" && --depth < 0) return false;
+        if (type == "," && depth == 0) {
+            any_t x;
+            if (arg.empty() || !get_token_value(arg, st, x) || !is_integer_value(x)) return false;
+            args.push_back(std::move(x));
+            arg.clear();
+        } else {
+            arg.push_back(t[i]);
+        }
+    }
+    if (depth != 0) return false;
+    if (!arg.empty()) {
+        any_t x;
+        if (!get_token_value(arg, st, x) || !is_integer_value(x)) return false;
+        args.push_back(std::move(x));
+    } else if (!args.empty()) {
+        return false;
+    }
+
+    std::shared_ptr<const subroutine_t> sub;
+    if (st.scope != nullptr && st.scope->subroutines != nullptr && st.scope->subroutines->count(name)) {
+        sub = st.scope->subroutines->at(name);
+    } else {
+        std::cerr << "[ qes ] subroutine \"" << name << "\" is not defined." << std::endl;
+        exit(1);
+    }
+    if (sub->params.size() != args.size()) {
+        std::cerr << "[ qes ] subroutine \"" << name << "\" takes " << sub->params.size()
+            << " arguments, but " << args.size() << " were given." << std::endl;
+        exit(1);
+    }
+    st.call = block_t();
+    st.call.subroutine = std::move(sub);
+    st.call.args = std::move(args);
+    st.reset();
+    return true;
+}
+
 status_t
 parse_awaiting_token(std::string type, std::string val, parse_state_t& st) {
     if (type == "IDENTIFIER") {
@@ -22,6 +130,20 @@ parse_awaiting_token(std::string type, std::string val, parse_state_t& st) {
             return status_t::invalid;
         }
         return status_t::in_repeat;
+    } else if (type == "def") {
+        if (st.annotations.size() || st.property_map.size()
+            || st.scope == nullptr || !st.scope->allow_definitions)
+        {
+            return status_t::invalid;
+        }
+        st.def_name.clear();
+        st.def_params.clear();
+        st.in_def_step = 0;
+        return status_t::in_definition;
+    } else if (type == "include") {
+        if (st.annotations.size() || st.property_map.size()) return status_t::invalid;
+        st.include_path.clear();
+        return status_t::in_include;
     } else if (type == "}") {
         return status_t::exit_block;
     }
@@ -30,31 +152,43 @@ parse_awaiting_token(std::string type, std::string val, parse_state_t& st) {
 
 status_t
 parse_in_instruction(std::string type, std::string val, parse_state_t& st) {
-    if (type == "I_LITERAL" || type == "F_LITERAL" || type == "S_LITERAL") {
-        if (st.in_inst_awaiting_sep) {
+    // Operands are read token by token, and are only converted once the
+    // separator after them (a "," or ";" outside of parentheses) is read.
+    if (st.expr_depth == 0 && type == ";" && is_call(st)) {
+        return finish_call(st) ? status_t::call_subroutine : status_t::invalid;
+    } else if (st.expr_depth == 0 && (type == "," || type == ";")) {
+        if (!st.expr_tokens.empty()) {
+            any_t x;
+            if (!finish_value(st, x)) return status_t::invalid;
+            st.inst_operands.push_back(std::move(x));
+        } else if (type == ",") {
             return status_t::invalid;
         }
-        st.inst_operands.push_back(get_literal_val(type, val));
-        st.in_inst_awaiting_sep = true;
-        return status_t::in_instruction;
-    } else if (type == "," && st.in_inst_awaiting_sep) {
-        st.in_inst_awaiting_sep = false;
-        return status_t::in_instruction;
-    } else if (type == ";") {
+        if (type == ",") return status_t::in_instruction;
         // Push the instruction onto the program.
-        Instruction<> inst(st.inst_name, st.inst_operands);
+        Instruction<>& inst = st.program.emplace_back(st.inst_name, st.inst_operands);
         for (std::string a : st.annotations) {
             inst.put(a);
         }
         for (auto& [ k, v ] : st.property_map) {
             inst.put(k, v);
         }
-        st.program.push_back(inst);
 
         st.reset();
         return status_t::awaiting_token;
+    } else if (type == "," && st.expr_depth == 1 && is_call_prefix(st)) {
+        // A comma between the arguments of a call.
+        if (!can_extend_value(type, val, st)) return status_t::invalid;
+    } else if (!is_expression_token(type) || !can_extend_value(type, val, st)) {
+        return status_t::invalid;
+    } else if (type == "(") {
+        st.expr_depth++;
+    } else if (type == ")") {
+        if (st.expr_depth == 0) return status_t::invalid;
+        st.expr_depth--;
     }
-    return status_t::invalid;
+    st.expr_tokens.emplace_back(type, val);
+    return status_t::in_instruction;
 }
 
 status_t
@@ -77,13 +211,25 @@ parse_in_annotation(std::string type, std::string val, parse_state_t& st) {
 status_t
 parse_in_property(std::string type, std::string val, parse_state_t& st) {
     if (st.in_property_awaiting_val) {
-        if (type == "I_LITERAL" || type == "F_LITERAL" || type == "S_LITERAL") {
-            st.property_map[st.property_name] = get_literal_val(type, val);
-            st.in_property_awaiting_val = false;
-            return status_t::awaiting_token;
-        } else {
+        // The value is a single token (possibly negated), or is parenthesized.
+        if (type == "(") {
+            st.expr_depth++;
+        } else if (type == ")") {
+            if (st.expr_depth == 0) return status_t::invalid;
+            st.expr_depth--;
+        } else if (!is_expression_token(type) || (type == "S_LITERAL" && !st.expr_tokens.empty())) {
             return status_t::invalid;
         }
+        if (!can_extend_value(type, val, st)) return status_t::invalid;
+        st.expr_tokens.emplace_back(type, val);
+        if (st.expr_depth > 0 || type == "-" || (type != ")" && !is_value_token(type))) {
+            return status_t::in_property;
+        }
+        any_t x;
+        if (!finish_value(st, x)) return status_t::invalid;
+        st.property_map[st.property_name] = std::move(x);
+        st.in_property_awaiting_val = false;
+        return status_t::awaiting_token;
     } else {
         if (type != "IDENTIFIER") {
             return status_t::invalid;
@@ -104,20 +250,157 @@ parse_in_label(std::string type, std::string val, parse_state_t& st) {
 
 status_t
 parse_in_repeat(std::string type, std::string val, parse_state_t& st) {
-    if (type == "(" && st.in_repeat_awaiting_ctr_step == 0) {
-        st.in_repeat_awaiting_ctr_step++;
+    // The header is either (N) or (var, N). The steps are:
+    //  0: "(" -> 1
+    //  1: I_LITERAL -> 2, or IDENTIFIER -> 4
+    //  4: "," -> 5
+    //  5: I_LITERAL -> 2
+    //  2: ")" -> 3
+    //  3: "{" -> enter the block
+    int& step = st.in_repeat_awaiting_ctr_step;
+    if (type == "(" && step == 0) {
+        st.repeat_var.clear();
+        step = 1;
         return status_t::in_repeat;
-    } else if (type == "I_LITERAL" && st.in_repeat_awaiting_ctr_step == 1) {
+    } else if (type == "I_LITERAL" && (step == 1 || step == 5)) {
         st.repeat_ctr = std::stoll(val);
-        st.in_repeat_awaiting_ctr_step++;
+        step = 2;
+        return status_t::in_repeat;
+    } else if (type == "IDENTIFIER" && step == 1) {
+        st.repeat_var = val;
+        step = 4;
+        return status_t::in_repeat;
+    } else if (type == "," && step == 4) {
+        step = 5;
         return status_t::in_repeat;
-    } else if (type == ")" && st.in_repeat_awaiting_ctr_step == 2) {
-        st.in_repeat_awaiting_ctr_step++;
+    } else if (type == ")" && step == 2) {
+        step = 3;
         return status_t::in_repeat;
-    } else if (type == "{" && st.in_repeat_awaiting_ctr_step == 3) {
+    } else if (type == "{" && step == 3) {
         return status_t::enter_subblock;
     }
     return status_t::invalid;
 }
 
+static bool
+get_token_value(const std::vector<Token>& tokens, const parse_state_t& st, any_t& out) {
+    // Literals are converted directly. Expressions only support integers, so
+    // negative floats are handled here.
+    if (tokens.size() == 1 && std::get<0>(tokens[0]) != "IDENTIFIER") {
+        out = get_literal_val(std::get<0>(tokens[0]), std::get<1>(tokens[0]));
+        return is_value_token(std::get<0>(tokens[0]));
+    }
+    if (tokens.size() == 2 && std::get<0>(tokens[0]) == "-" && std::get<0>(tokens[1]) == "F_LITERAL") {
+        out = -std::stod(std::get<1>(tokens[1]));
+        return true;
+    }
+    expr_t e;
+    if (!parse_expression(tokens, e)) return false;
+    if (uses_variables(e) && (st.scope == nullptr || !all_variables_bound(e, st.scope->loop_vars))) {
+        return false;
+    }
+    out = make_expression_value(std::move(e));
+    return true;
+}
+
+status_t
+parse_in_definition(std::string type, std::string val, parse_state_t& st) {
+    // The header is def name(param, ...). The steps are:
+    //  0: IDENTIFIER (the name) -> 1
+    //  1: "(" -> 2
+    //  2: IDENTIFIER -> 3, or ")" -> 4
+    //  3: "," -> 5, or ")" -> 4
+    //  5: IDENTIFIER -> 3
+    //  4: "{" -> enter the body
+    int& step = st.in_def_step;
+    if (type == "IDENTIFIER" && step == 0) {
+        st.def_name = val;
+        step = 1;
+    } else if (type == "(" && step == 1) {
+        step = 2;
+    } else if (type == "IDENTIFIER" && (step == 2 || step == 5)) {
+        const uint32_t id = intern_string(val);
+        if (std::find(st.def_params.begin(), st.def_params.end(), id) != st.def_params.end()) {
+            return status_t::invalid;
+        }
+        st.def_params.push_back(id);
+        step = 3;
+    } else if (type == "," && step == 3) {
+        step = 5;
+    } else if (type == ")" && (step == 2 || step == 3)) {
+        step = 4;
+    } else if (type == "{" && step == 4) {
+        step = 0;
+        return status_t::enter_definition;
+    } else {
+        return status_t::invalid;
+    }
+    return status_t::in_definition;
+}
+
+status_t
+parse_in_include(std::string type, std::string val, parse_state_t& st) {
+    // The statement is include "path";
+    if (type == "S_LITERAL" && st.include_path.empty()) {
+        // Remove the quotes around the path.
+        st.include_path = val.substr(1, val.size()-2);
+        return st.include_path.empty() ? status_t::invalid : status_t::in_include;
+    } else if (type != ";" || st.include_path.empty()) {
+        return status_t::invalid;
+    }
+    std::shared_ptr<const module_t> m = load_module(st.include_path);
+    st.include_path.clear();
+    // The module's subroutines are added to the scope, so they can only be
+    // included where subroutines can be defined.
+    if (!m->subroutines.empty()) {
+        if (st.scope == nullptr || !st.scope->allow_definitions) return status_t::invalid;
+        subroutine_table_t& table = *st.scope->subroutines;
+        for (const auto& [ name, sub ] : m->subroutines) {
+            auto it = table.find(name);
+            if (it != table.end() && it->second != sub) {
+                std::cerr << "[ qes ] subroutine \"" << name << "\" (included from \"" << m->path
+                    << "\") is already defined." << std::endl;
+                exit(1);
+            }
+            table[name] = sub;
+        }
+    }
+    st.call = block_t();
+    st.call.subroutine = m->body;
+    return status_t::call_subroutine;
+}
+
+parse_scope_t
+get_definition_scope(const parse_state_t& st) {
+    // The body can only use its parameters.
+    parse_scope_t s;
+    s.loop_vars = st.def_params;
+    s.subroutines = st.scope->subroutines;
+    return s;
+}
+
+void
+define_subroutine(const parse_state_t& st, block_t body) {
+    subroutine_table_t& table = *st.scope->subroutines;
+    if (table.count(st.def_name)) {
+        std::cerr << "[ qes ] subroutine \"" << st.def_name << "\" is already defined." << std::endl;
+        exit(1);
+    }
+    auto sub = std::make_shared<subroutine_t>();
+    sub->name = st.def_name;
+    sub->params = st.def_params;
+    sub->expanded_size = get_expanded_size(body);
+    sub->body = std::move(body);
+    table[st.def_name] = std::move(sub);
+}
+
+bool
+finish_value(parse_state_t& st, any_t& out) {
+    bool ok = get_token_value(st.expr_tokens, st, out);
+    // Clearing the tokens keeps their capacity for the next value.
+    st.expr_tokens.clear();
+    st.expr_depth = 0;
+    return ok;
+}
+
 }   // qes
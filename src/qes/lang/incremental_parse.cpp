@@ -0,0 +1,177 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/incremental_parse.h"
+
+namespace qes {
+
+IncrementalParser::IncrementalParser()
+    :IncrementalParser(nullptr)
+{}
+
+IncrementalParser::IncrementalParser(callback_t cb)
+    :callback(cb),
+    ready(),
+    tokenizer(),
+    status(status_t::awaiting_token),
+    block_stack(1),
+    compressed_stack(),
+    scopes(1),
+    subroutines(),
+    in_definition(false),
+    st({0, 0})
+{
+    scopes[0].allow_definitions = true;
+}
+
+void
+IncrementalParser::feed(const char* buf, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        char c = buf[i];
+        // Update the debug state (once per character, even if the character
+        // ends up being rescanned by consume).
+        if (c == '\n') {
+            st.line++;
+            st.col = 0;
+        } else {
+            st.col++;
+        }
+        consume(c);
+    }
+}
+
+void
+IncrementalParser::finish() {
+    end_token();
+    if (block_stack.size() > 1 || status != status_t::awaiting_token) {
+        std::cerr << "[ qes ] unexpected end of input at " << st << std::endl;
+        exit(1);
+    }
+    flush_top_level();
+}
+
+void
+IncrementalParser::consume(char c) {
+    Tokenizer::scan_t r = tokenizer.scan(c, st);
+    if (r == Tokenizer::scan_t::more) return;
+    end_token();
+    // Instead of ungetting a character that ends a token (as read_next_token
+    // does), we scan the character again.
+    if (r == Tokenizer::scan_t::end_before) consume(c);
+}
+
+void
+IncrementalParser::end_token() {
+    auto [ type, val ] = tokenizer.take();
+    if (type == T_empty) return;
+    recv_token(type, val);
+}
+
+void
+IncrementalParser::recv_token(token_type type, std::string val) {
+    parse_state_t& p_st = block_stack.back();
+    // All blocks share the subroutines (set here, so the parser can be moved).
+    scopes.back().subroutines = &subroutines;
+    p_st.scope = &scopes.back();
+    status = parse_token(status, type, val, p_st);
+    if (!compressed_stack.empty() && !p_st.program.empty()) {
+        block_t& blk = compressed_stack.back();
+        blk.instructions.insert(blk.instructions.end(),
+                std::make_move_iterator(p_st.program.begin()), std::make_move_iterator(p_st.program.end()));
+        p_st.program.clear();
+    }
+    // Handle status result. Unlike read_block, the block structure is kept on
+    // block_stack rather than on the call stack.
+    if (status == status_t::invalid) {
+        raise_syntax_error(std::make_tuple(type, val), st);
+    } else if (status == status_t::exit_block && !compressed_stack.empty()) {
+        block_t blk = std::move(compressed_stack.back());
+        compressed_stack.pop_back();
+        block_stack.pop_back();
+        scopes.pop_back();
+
+        parse_state_t& parent = block_stack.back();
+        parent.scope = &scopes.back();
+        if (compressed_stack.empty() && in_definition) {
+            define_subroutine(parent, std::move(blk));
+            in_definition = false;
+        } else if (compressed_stack.empty()) {
+            reserve_more(parent.program, get_expanded_size(blk));
+            for_each_expanded(blk, [&] (Instruction<>&& inst) { parent.program.push_back(std::move(inst)); });
+        } else {
+            block_t& outer = compressed_stack.back();
+            outer.subblock_pos.push_back(outer.instructions.size());
+            outer.subblocks.push_back(std::move(blk));
+        }
+        parent.in_repeat_awaiting_ctr_step = 0;
+        status = status_t::awaiting_token;
+    } else if (status == status_t::exit_block) {
+        if (block_stack.size() == 1) {
+            // There is no block to exit.
+            raise_syntax_error(std::make_tuple(type, val), st);
+        }
+        Program<> blk = std::move(block_stack.back().program);
+        block_stack.pop_back();
+        scopes.pop_back();
+
+        parse_state_t& parent = block_stack.back();
+        parent.program.reserve(parent.program.size() + blk.size()*parent.repeat_ctr);
+        while (parent.repeat_ctr--) {
+            parent.program.insert(parent.program.end(), blk.begin(), blk.end());
+        }
+        parent.in_repeat_awaiting_ctr_step = 0;
+        status = status_t::awaiting_token;
+    } else if (status == status_t::enter_subblock) {
+        scopes.push_back(scopes.back().nested());
+        if (!p_st.repeat_var.empty() || !compressed_stack.empty()) {
+            block_t blk;
+            blk.repeat_count = p_st.repeat_ctr;
+            if (!p_st.repeat_var.empty()) {
+                blk.loop_var = intern_string(p_st.repeat_var);
+                scopes.back().loop_vars.push_back(blk.loop_var);
+            }
+            compressed_stack.push_back(std::move(blk));
+        }
+        block_stack.emplace_back();
+        status = status_t::awaiting_token;
+    } else if (status == status_t::enter_definition) {
+        scopes.push_back(get_definition_scope(p_st));
+        compressed_stack.emplace_back();
+        in_definition = true;
+        block_stack.emplace_back();
+        status = status_t::awaiting_token;
+    } else if (status == status_t::call_subroutine) {
+        if (compressed_stack.empty()) {
+            reserve_more(p_st.program, get_expanded_size(p_st.call));
+            for_each_expanded(p_st.call, [&] (Instruction<>&& inst) { p_st.program.push_back(std::move(inst)); });
+        } else {
+            block_t& outer = compressed_stack.back();
+            outer.subblock_pos.push_back(outer.instructions.size());
+            outer.subblocks.push_back(std::move(p_st.call));
+        }
+        status = status_t::awaiting_token;
+    }
+    flush_top_level();
+}
+
+void
+IncrementalParser::flush_top_level() {
+    if (block_stack.size() > 1) return;
+    Program<>& prog = block_stack[0].program;
+    if (prog.empty()) return;
+    if (callback == nullptr) {
+        if (ready.empty()) {
+            ready = std::move(prog);
+        } else {
+            ready.insert(ready.end(),
+                    std::make_move_iterator(prog.begin()), std::make_move_iterator(prog.end()));
+        }
+    } else {
+        for (Instruction<>& inst : prog) callback(std::move(inst));
+    }
+    prog.clear();
+}
+
+}   // qes
@@ -0,0 +1,244 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/fast_parse_impl.h"
+#include "qes/lang/index.h"
+#include "qes/lang/module.h"
+#include "qes/util/compression.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <string.h>
+#include <unistd.h>
+
+namespace qes {
+
+namespace fs = std::filesystem;
+
+static const char INDEX_MAGIC[4] = { 'Q', 'I', 'D', 'X' };
+static const uint32_t INDEX_FORMAT_VERSION = 2;
+
+instruction_index_t
+build_index(std::istream& fin, uint64_t stride) {
+    instruction_index_t index;
+    debug_state_t st = {0, 0};
+
+    subroutine_table_t subroutines;
+    parse_scope_t scope;
+    scope.subroutines = &subroutines;
+    scope.allow_definitions = true;
+
+    // Each top-level statement is read into a scratch block, which is cleared
+    // afterwards, so only one statement is in memory at a time.
+    block_t stmt;
+    index_entry_t next = { 0, 0, 0, 0, 1, 1 };
+    size_t n_subroutines = 0;
+    while (read_compressed_statement(fin, st, stmt, &scope)) {
+        if (stmt.instructions.empty() && stmt.subblocks.empty()) {
+            // This is a subroutine definition.
+            index.definitions.push_back(next);
+            n_subroutines = subroutines.size();
+            next = { st.bytes, st.line, st.col, index.n_instructions, 1, 1 };
+            continue;
+        }
+        // Includes may also define subroutines.
+        if (subroutines.size() != n_subroutines) {
+            index.definitions.push_back(next);
+            n_subroutines = subroutines.size();
+        }
+        // Repeat blocks and calls are both stored as subblocks.
+        const bool is_repeat = stmt.instructions.empty();
+        if (is_repeat) {
+            const block_t& sub = stmt.subblocks[0];
+            next.repeat_count = std::max(sub.repeat_count, int64_t(0));
+            next.period = next.repeat_count == 0 ? 0 : get_expanded_size(sub) / next.repeat_count;
+        }
+        const uint64_t n = next.period * next.repeat_count;
+        // Repeat blocks always get a checkpoint (unless they are empty).
+        // Instructions get one if the last checkpoint is too far back.
+        if (n > 0) {
+            const index_entry_t* last = index.entries.empty() ? nullptr : &index.entries.back();
+            if (is_repeat || last == nullptr || last->period*last->repeat_count > 1
+                    || next.first - last->first >= stride)
+            {
+                index.entries.push_back(next);
+            }
+        }
+        index.n_instructions += n;
+
+        next = { st.bytes, st.line, st.col, index.n_instructions, 1, 1 };
+        stmt = block_t();
+    }
+    return index;
+}
+
+void
+write_index(std::ostream& out, const instruction_index_t& index) {
+    auto write_u64 = [&] (uint64_t x) { out.write(reinterpret_cast<const char*>(&x), 8); };
+
+    out.write(INDEX_MAGIC, 4);
+    out.write(reinterpret_cast<const char*>(&INDEX_FORMAT_VERSION), 4);
+    write_u64(index.n_instructions);
+    write_u64(index.file_size);
+    write_u64(static_cast<uint64_t>(index.file_mtime));
+    for (const std::vector<index_entry_t>* v : { &index.entries, &index.definitions }) {
+        write_u64(v->size());
+        for (const index_entry_t& e : *v) {
+            write_u64(e.offset);
+            write_u64(e.line);
+            write_u64(e.col);
+            write_u64(e.first);
+            write_u64(e.period);
+            write_u64(e.repeat_count);
+        }
+    }
+}
+
+bool
+read_index(std::istream& in, instruction_index_t& index) {
+    auto read_u64 = [&] (uint64_t& x) {
+        in.read(reinterpret_cast<char*>(&x), 8);
+        return in.gcount() == 8;
+    };
+
+    char magic[4];
+    uint32_t version;
+    in.read(magic, 4);
+    if (in.gcount() != 4 || memcmp(magic, INDEX_MAGIC, 4) != 0) return false;
+    in.read(reinterpret_cast<char*>(&version), 4);
+    if (in.gcount() != 4 || version != INDEX_FORMAT_VERSION) return false;
+
+    uint64_t mtime;
+    if (!read_u64(index.n_instructions) || !read_u64(index.file_size) || !read_u64(mtime)) {
+        return false;
+    }
+    index.file_mtime = static_cast<int64_t>(mtime);
+    for (std::vector<index_entry_t>* v : { &index.entries, &index.definitions }) {
+        uint64_t n_entries;
+        if (!read_u64(n_entries)) return false;
+        v->clear();
+        for (uint64_t i = 0; i < n_entries; i++) {
+            index_entry_t e;
+            if (!read_u64(e.offset) || !read_u64(e.line) || !read_u64(e.col)
+                || !read_u64(e.first) || !read_u64(e.period) || !read_u64(e.repeat_count))
+            {
+                return false;
+            }
+            v->push_back(e);
+        }
+    }
+    return true;
+}
+
+instruction_index_t
+load_index(std::string file) {
+    std::error_code ec;
+    const uint64_t file_size = fs::file_size(file, ec);
+    if (ec) {
+        std::cerr << "[ qes ] could not open \"" << file << "\"." << std::endl;
+        exit(1);
+    }
+    const int64_t file_mtime = fs::last_write_time(file, ec).time_since_epoch().count();
+
+    instruction_index_t index;
+    const std::string index_file = get_index_file(file);
+    {
+        std::ifstream fin(index_file, std::ios::binary);
+        if (fin.is_open() && read_index(fin, index)
+            && index.file_size == file_size && index.file_mtime == file_mtime)
+        {
+            return index;
+        }
+    }
+    // The sidecar is missing or stale.
+    const uint64_t n_includes = get_number_of_includes();
+    {
+        IncludeGuard guard(file);
+        compressed_ifstream fin(file);
+        index = build_index(fin);
+    }
+    // The sidecar is only checked against this file, so it is not written for
+    // programs that include other files (see qes/lang/module.h).
+    if (get_number_of_includes() != n_includes) return index;
+    index.file_size = file_size;
+    index.file_mtime = file_mtime;
+    // Write to a temporary file first, so readers never see a partial index.
+    // The name is unique to this thread, as others may be indexing the file.
+    std::ostringstream tmp_name;
+    tmp_name << index_file << ".tmp." << getpid() << "." << std::this_thread::get_id();
+    const std::string tmp_file = tmp_name.str();
+    {
+        std::ofstream fout(tmp_file, std::ios::binary);
+        if (!fout.is_open()) return index;  // The sidecar is optional.
+        write_index(fout, index);
+        fout.close();
+        if (fout.fail()) {
+            fs::remove(tmp_file, ec);
+            return index;
+        }
+    }
+    fs::rename(tmp_file, index_file, ec);
+    if (ec) fs::remove(tmp_file, ec);
+    return index;
+}
+
+Program<>
+read_range(std::string file, uint64_t begin, uint64_t end, const instruction_index_t& index) {
+    Program<> out;
+    end = std::min(end, index.n_instructions);
+    const index_entry_t* e = index.find(begin);
+    if (begin >= end || e == nullptr) return out;
+    out.reserve(end - begin);
+
+    IncludeGuard guard(file);
+    compressed_ifstream fin(file);
+    const bool can_seek = detect_compression(file) == compression_t::none;
+    uint64_t fin_offset = 0;
+    auto skip_to = [&] (uint64_t offset) {
+        if (can_seek) {
+            fin.seekg(offset);
+        } else {
+            // Compressed streams cannot seek, but we can still skip parsing.
+            fin.ignore(offset - fin_offset);
+        }
+        fin_offset = offset;
+    };
+
+    subroutine_table_t subroutines;
+    parse_scope_t scope;
+    scope.subroutines = &subroutines;
+    scope.allow_definitions = true;
+
+    block_t stmt;
+    // Read the subroutines defined before the checkpoint.
+    for (const index_entry_t& d : index.definitions) {
+        if (d.offset >= e->offset) break;
+        skip_to(d.offset);
+        debug_state_t st = { d.line, d.col, d.offset };
+        read_compressed_statement(fin, st, stmt, &scope);
+        fin_offset = st.bytes;
+        stmt = block_t();
+    }
+    skip_to(e->offset);
+    debug_state_t st = { e->line, e->col, e->offset };
+
+    uint64_t pos = e->first;
+    while (pos < end && read_compressed_statement(fin, st, stmt, &scope)) {
+        // stmt is an instruction, a repeat block or call, or a definition.
+        const uint64_t n = stmt.instructions.empty()
+                            ? (stmt.subblocks.empty() ? 0 : get_expanded_size(stmt.subblocks[0])) : 1;
+        if (pos + n > begin) {
+            expand_range(stmt, begin > pos ? begin - pos : 0, end - pos, out);
+        }
+        pos += n;
+        stmt = block_t();
+    }
+    return out;
+}
+
+}   // qes
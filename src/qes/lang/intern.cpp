@@ -0,0 +1,63 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/block.h"
+#include "qes/lang/fast_parse_impl.h"
+#include "qes/lang/intern.h"
+
+namespace qes {
+
+InternedProgram<>
+fast_read_interned_program(std::istream& fin, InstructionPool<>& pool) {
+    debug_state_t st = {0, 0};
+    return read_interned_block(fin, st, pool);
+}
+
+// Appends the expanded block to the program. Outside of loop variables and
+// calls, the instructions have no expressions to evaluate, so the body is
+// interned once and its handles are copied for the remaining repeats.
+static void
+intern_expanded(const block_t& blk, InstructionPool<>& pool, InternedProgram<>& out) {
+    if (blk.loop_var != block_t::NO_LOOP_VAR || blk.subroutine != nullptr) {
+        for_each_expanded(blk, [&] (Instruction<>&& inst) { out.push_back(pool.intern(std::move(inst))); });
+        return;
+    }
+    if (blk.repeat_count <= 0) return;
+    reserve_more(out, get_expanded_size(blk));
+    const size_t start = out.size();
+    for_each_statement(blk,
+        [&] (const Instruction<>& inst) { out.push_back(pool.intern(inst)); },
+        [&] (const block_t& sub) { intern_expanded(sub, pool, out); });
+    const size_t end = out.size();
+    for (int64_t i = 1; i < blk.repeat_count; i++) {
+        for (size_t j = start; j < end; j++) out.push_back(out[j]);
+    }
+}
+
+InternedProgram<>
+read_interned_block(std::istream& fin, debug_state_t& st, InstructionPool<>& pool, const parse_scope_t* scope) {
+    // This is read_block, except that every completed instruction is moved into
+    // the pool as soon as it is parsed.
+    subroutine_table_t subroutines;
+    parse_scope_t top_scope;
+    if (scope == nullptr) {
+        top_scope.subroutines = &subroutines;
+        top_scope.allow_definitions = true;
+        scope = &top_scope;
+    }
+    parse_state_t p_st;
+    p_st.scope = scope;
+    InternedProgram<> program;
+
+    block_t stmt;
+    while (read_statement(fin, st, p_st, stmt)) {
+        for (Instruction<>& inst : stmt.instructions) program.push_back(pool.intern(std::move(inst)));
+        for (const block_t& sub : stmt.subblocks) intern_expanded(sub, pool, program);
+        stmt.clear();
+    }
+    return program;
+}
+
+}   // qes
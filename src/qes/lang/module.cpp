@@ -0,0 +1,156 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/fast_parse_impl.h"
+#include "qes/lang/module.h"
+#include "qes/util/compression.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <mutex>
+
+namespace qes {
+
+namespace fs = std::filesystem;
+
+// The modules a module includes (directly or not), and their modification
+// times when it was read.
+typedef std::map<std::string, fs::file_time_type> dependency_map_t;
+
+struct module_entry_t {
+    fs::file_time_type              mtime;
+    dependency_map_t                dependencies;
+    std::shared_ptr<const module_t> module;
+};
+
+static std::mutex                               MODULE_MTX;
+static std::map<std::string, module_entry_t>    MODULE_CACHE;
+
+// The files being read on this thread, outermost first.
+static thread_local std::vector<std::string>    INCLUDE_STACK;
+static thread_local uint64_t                    INCLUDE_COUNT = 0;
+// The dependencies of each module being read on this thread, outermost first.
+static thread_local std::vector<dependency_map_t>   DEPENDENCY_STACK;
+
+IncludeGuard::IncludeGuard(const std::string& file) {
+    std::error_code ec;
+    std::string path = fs::weakly_canonical(fs::absolute(file), ec).string();
+    if (ec) path = file;
+    if (std::find(INCLUDE_STACK.begin(), INCLUDE_STACK.end(), path) != INCLUDE_STACK.end()) {
+        std::cerr << "[ qes ] include cycle:";
+        for (const std::string& f : INCLUDE_STACK) std::cerr << " \"" << f << "\" ->";
+        std::cerr << " \"" << path << "\"" << std::endl;
+        exit(1);
+    }
+    INCLUDE_STACK.push_back(std::move(path));
+}
+
+IncludeGuard::~IncludeGuard() {
+    INCLUDE_STACK.pop_back();
+}
+
+std::string
+resolve_include_path(const std::string& file) {
+    fs::path p(file);
+    if (p.is_relative()) {
+        p = INCLUDE_STACK.empty() ? fs::current_path() / p : fs::path(INCLUDE_STACK.back()).parent_path() / p;
+    }
+    std::error_code ec;
+    fs::path canonical = fs::canonical(p, ec);
+    if (ec) {
+        std::cerr << "[ qes ] could not find included file \"" << file << "\"." << std::endl;
+        exit(1);
+    }
+    return canonical.string();
+}
+
+uint64_t
+get_number_of_includes() {
+    return INCLUDE_COUNT;
+}
+
+static std::shared_ptr<const module_t>
+read_module(const std::string& path) {
+    compressed_ifstream fin(path);
+    if (!fin.good()) {
+        std::cerr << "[ qes ] could not read included file \"" << path << "\"." << std::endl;
+        exit(1);
+    }
+    auto m = std::make_shared<module_t>();
+    m->path = path;
+
+    debug_state_t st = {0, 0};
+    parse_scope_t scope;
+    scope.subroutines = &m->subroutines;
+    scope.allow_definitions = true;
+
+    auto body = std::make_shared<subroutine_t>();
+    body->name = path;
+    body->body = read_compressed_block(fin, st, &scope);
+    body->expanded_size = get_expanded_size(body->body);
+    m->body = std::move(body);
+    return m;
+}
+
+std::shared_ptr<const module_t>
+load_module(const std::string& file) {
+    const std::string path = resolve_include_path(file);
+    // This exits if the module is being read (i.e., it includes itself).
+    IncludeGuard guard(path);
+    INCLUDE_COUNT++;
+
+    std::error_code ec;
+    const fs::file_time_type mtime = fs::last_write_time(path, ec);
+    module_entry_t e;
+    {
+        std::lock_guard<std::mutex> lk(MODULE_MTX);
+        auto it = MODULE_CACHE.find(path);
+        if (it != MODULE_CACHE.end() && it->second.mtime == mtime) e = it->second;
+    }
+    // A cached module is only valid if none of its includes were modified.
+    if (e.module != nullptr) {
+        for (const auto& [ dep, dep_mtime ] : e.dependencies) {
+            if (fs::last_write_time(dep, ec) != dep_mtime) {
+                e.module = nullptr;
+                break;
+            }
+        }
+    }
+    if (e.module == nullptr) {
+        // The module is read without holding the lock, as it may include other
+        // modules. If two threads miss at once, both read the module and the
+        // last one is kept.
+        DEPENDENCY_STACK.emplace_back();
+        e.module = read_module(path);
+        e.mtime = mtime;
+        e.dependencies = std::move(DEPENDENCY_STACK.back());
+        DEPENDENCY_STACK.pop_back();
+
+        std::lock_guard<std::mutex> lk(MODULE_MTX);
+        MODULE_CACHE[path] = e;
+    }
+    // The module (and its includes) are dependencies of the module including it.
+    if (!DEPENDENCY_STACK.empty()) {
+        dependency_map_t& deps = DEPENDENCY_STACK.back();
+        deps[path] = mtime;
+        deps.insert(e.dependencies.begin(), e.dependencies.end());
+    }
+    return e.module;
+}
+
+void
+clear_module_cache() {
+    std::lock_guard<std::mutex> lk(MODULE_MTX);
+    MODULE_CACHE.clear();
+}
+
+size_t
+get_module_cache_size() {
+    std::lock_guard<std::mutex> lk(MODULE_MTX);
+    return MODULE_CACHE.size();
+}
+
+}   // qes
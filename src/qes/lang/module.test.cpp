@@ -0,0 +1,98 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ *
+ *  Fails if a program with includes (see qes/lang/module.h) does not read as
+ *  its plain expansion, if a module is not read again after one of its
+ *  includes is modified, or if an include cycle does not exit with an error.
+ * */
+
+#include <qes.h>
+#include <qes/lang/block.h>
+#include <qes/lang/module.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace qes;
+namespace fs = std::filesystem;
+
+void
+write_file(const fs::path& file, const std::string& text) {
+    fs::create_directories(file.parent_path());
+    const bool existed = fs::exists(file);
+    const fs::file_time_type mtime = existed ? fs::last_write_time(file) : fs::file_time_type();
+    std::ofstream(file) << text;
+    // Make sure that a rewritten file has a new modification time.
+    if (existed) fs::last_write_time(file, mtime + std::chrono::seconds(1));
+}
+
+bool
+check(std::string name, const Program<>& program, const std::string& flat) {
+    std::istringstream flat_in(flat);
+    if (program == fast_read_program(flat_in)) return true;
+    std::cerr << "[ qes ] " << name << " does not match \"" << flat << "\"." << std::endl;
+    return false;
+}
+
+bool
+check_all_readers(const fs::path& file, const std::string& flat) {
+    bool ok = check("fast_read_from_file(" + file.string() + ")", fast_read_from_file(file.string()), flat);
+    ok &= check("safe_read_from_file(" + file.string() + ")", safe_read_from_file(file.string()), flat);
+    std::ifstream in(file);
+    IncludeGuard guard(file.string());
+    ok &= check("read_compressed_program(" + file.string() + ")", expand(read_compressed_program(in)), flat);
+    return ok;
+}
+
+// Returns true if reading the file exits with an error.
+bool
+read_fails(const fs::path& file) {
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        fast_read_from_file(file.string());
+        _exit(0);
+    }
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid) return false;
+    return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+int main() {
+    const fs::path dir = fs::temp_directory_path() / ("qes_module_test." + std::to_string(getpid()));
+    write_file(dir / "b.qes", "def g(p) { y p; }\ny 2;\n");
+    write_file(dir / "a.qes", "include \"b.qes\";\nx 1;\n");
+    write_file(dir / "d.qes", "z 3;\n");
+    // Includes are relative to the including file.
+    write_file(dir / "sub" / "c.qes", "include \"../d.qes\";\n");
+    write_file(dir / "main.qes",
+                "include \"a.qes\";\nrepeat (2) { include \"sub/c.qes\"; }\ncall g(7);\n");
+    // A module may be included more than once.
+    write_file(dir / "twice.qes", "include \"a.qes\";\ninclude \"b.qes\";\ncall g(1);\n");
+
+    bool ok = check_all_readers(dir / "main.qes", "y 2; x 1; z 3; z 3; y 7;");
+    ok &= check_all_readers(dir / "twice.qes", "y 2; x 1; y 2; y 1;");
+
+    // main.qes includes d.qes through sub/c.qes.
+    write_file(dir / "d.qes", "z 4;\n");
+    ok &= check_all_readers(dir / "main.qes", "y 2; x 1; z 4; z 4; y 7;");
+
+    write_file(dir / "self.qes", "x 1;\ninclude \"self.qes\";\n");
+    write_file(dir / "e.qes", "include \"f.qes\";\n");
+    write_file(dir / "f.qes", "include \"e.qes\";\n");
+    write_file(dir / "cycle.qes", "include \"e.qes\";\n");
+    for (const char* file : { "self.qes", "cycle.qes" }) {
+        if (!read_fails(dir / file)) {
+            std::cerr << "[ qes ] the include cycle in " << file << " was not detected." << std::endl;
+            ok = false;
+        }
+    }
+    fs::remove_all(dir);
+    return ok ? 0 : 1;
+}
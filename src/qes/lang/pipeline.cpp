@@ -0,0 +1,75 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/module.h"
+#include "qes/lang/pipeline.h"
+#include "qes/util/compression.h"
+
+namespace qes {
+
+static const size_t PIPELINE_READ_SIZE = 1 << 16;
+
+PipelinedReader::PipelinedReader(std::string file, size_t batch_size, size_t max_batches)
+    :owned_stream(new compressed_ifstream(file)),
+    fin(*owned_stream),
+    batch_size(std::max(batch_size, size_t(1))),
+    queue(max_batches),
+    worker()
+{
+    if (!fin) {
+        std::cerr << "[ qes ] could not open \"" << file << "\"." << std::endl;
+        exit(1);
+    }
+    worker = std::thread([this, file] () {
+        IncludeGuard guard(file);
+        run();
+    });
+}
+
+PipelinedReader::PipelinedReader(std::istream& in, size_t batch_size, size_t max_batches)
+    :owned_stream(nullptr),
+    fin(in),
+    batch_size(std::max(batch_size, size_t(1))),
+    queue(max_batches),
+    worker()
+{
+    worker = std::thread([this] () { run(); });
+}
+
+PipelinedReader::~PipelinedReader() {
+    queue.cancel();
+    worker.join();
+}
+
+void
+PipelinedReader::run() {
+    Program<> batch;
+    batch.reserve(batch_size);
+    bool cancelled = false;
+
+    IncrementalParser parser(
+        [&] (Instruction<>&& inst) {
+            if (cancelled) return;
+            batch.push_back(std::move(inst));
+            if (batch.size() == batch_size) {
+                cancelled = !queue.push(std::move(batch));
+                batch = Program<>();
+                batch.reserve(batch_size);
+            }
+        });
+
+    std::vector<char> buf(PIPELINE_READ_SIZE);
+    while (!cancelled && fin) {
+        fin.read(buf.data(), buf.size());
+        parser.feed(buf.data(), fin.gcount());
+    }
+    if (!cancelled) {
+        parser.finish();
+        if (!batch.empty()) queue.push(std::move(batch));
+    }
+    queue.close();
+}
+
+}   // qes
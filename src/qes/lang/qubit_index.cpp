@@ -0,0 +1,111 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/qubit_index.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+namespace qes {
+
+static std::atomic<int64_t> MAX_QUBIT((1 << 24) - 1);
+
+void
+set_max_qubit(int64_t q) {
+    MAX_QUBIT = q;
+}
+
+int64_t
+get_max_qubit() {
+    return MAX_QUBIT;
+}
+
+void
+test_qubit_is_supported(int64_t q) {
+    if (q <= MAX_QUBIT) return;
+    std::cerr << "[ qes ] qubit " << q << " is larger than the maximum qubit (" << MAX_QUBIT
+        << "; see set_max_qubit)." << std::endl;
+    exit(1);
+}
+
+void
+QubitIndex::add(const Instruction<>& inst) {
+    const size_t n = inst.get_number_of_operands();
+    for (size_t i = 0; i < n; i++) {
+        any_t x = inst.get(i);
+        if (!holds_alternative<int64_t>(x) || qes::get<int64_t>(x) < 0) continue;
+        push(static_cast<uint64_t>(qes::get<int64_t>(x)), n_instructions);
+    }
+    n_instructions++;
+}
+
+void
+QubitIndex::update(const Program<>& program) {
+    for (uint64_t i = n_instructions; i < program.size(); i++) add(program[i]);
+}
+
+std::span<const uint64_t>
+QubitIndex::get(int64_t q) const {
+    if (q < 0 || static_cast<uint64_t>(q) >= counts.size()) return {};
+    return std::span<const uint64_t>(positions.data() + offsets[q], counts[q]);
+}
+
+void
+QubitIndex::compact() {
+    rebuild(1);
+}
+
+uint64_t
+QubitIndex::size() const {
+    return n_instructions;
+}
+
+size_t
+QubitIndex::get_number_of_qubits() const {
+    return counts.size();
+}
+
+void
+QubitIndex::push(uint64_t q, uint64_t pos) {
+    if (q >= counts.size()) {
+        test_qubit_is_supported(static_cast<int64_t>(q));
+        // New qubits get empty segments at the end.
+        counts.resize(q+1, 0);
+        offsets.resize(q+2, positions.size());
+    }
+    const uint64_t end = offsets[q] + counts[q];
+    // An instruction may use the same qubit more than once.
+    if (counts[q] > 0 && positions[end-1] == pos) return;
+    if (end < offsets[q+1]) {
+        positions[end] = pos;
+    } else if (q+1 == counts.size()) {
+        // The last segment can always grow.
+        positions.push_back(pos);
+        offsets[q+1] = positions.size();
+    } else {
+        rebuild(2);
+        positions[offsets[q] + counts[q]] = pos;
+    }
+    counts[q]++;
+}
+
+void
+QubitIndex::rebuild(uint64_t slack_factor) {
+    std::vector<uint64_t> new_offsets(counts.size()+1, 0);
+    for (size_t q = 0; q < counts.size(); q++) {
+        const uint64_t cap = slack_factor == 1 ? counts[q] : std::max(slack_factor*counts[q], uint64_t(4));
+        new_offsets[q+1] = new_offsets[q] + cap;
+    }
+    std::vector<uint64_t> new_positions(new_offsets.back());
+    for (size_t q = 0; q < counts.size(); q++) {
+        std::copy(positions.begin() + offsets[q], positions.begin() + offsets[q] + counts[q],
+                    new_positions.begin() + new_offsets[q]);
+    }
+    offsets = std::move(new_offsets);
+    positions = std::move(new_positions);
+}
+
+}   // qes
@@ -0,0 +1,198 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/query_index.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace qes {
+
+// Numbers are in category 0, and strings in category 1. Values of different
+// categories never compare.
+static int
+get_category(const any_t& x) {
+    return holds_alternative<std::string>(x) ? 1 : 0;
+}
+
+// Returns <0, 0, or >0 if x is less than, equal to, or greater than y, which
+// are in the same category.
+static int
+compare_values(const any_t& x, const any_t& y) {
+    if (holds_alternative<std::string>(x)) return get<std::string>(x).compare(get<std::string>(y));
+    if (holds_alternative<int64_t>(x) && holds_alternative<int64_t>(y)) {
+        const int64_t a = get<int64_t>(x), b = get<int64_t>(y);
+        return (a > b) - (a < b);
+    }
+    // A long double holds any int64_t exactly.
+    auto as_number = [] (const any_t& v) {
+        return holds_alternative<int64_t>(v) ? static_cast<long double>(get<int64_t>(v))
+                                             : static_cast<long double>(get<double>(v));
+    };
+    const long double a = as_number(x), b = as_number(y);
+    return (a > b) - (a < b);
+}
+
+static bool
+entry_less(const std::pair<any_t, uint64_t>& x, const std::pair<any_t, uint64_t>& y) {
+    const int cx = get_category(x.first), cy = get_category(y.first);
+    if (cx != cy) return cx < cy;
+    const int c = compare_values(x.first, y.first);
+    return c < 0 || (c == 0 && x.second < y.second);
+}
+
+query_term_t
+annotation_term(std::string name) {
+    return { query_term_t::kind_t::annotation, std::move(name) };
+}
+
+query_term_t
+property_term(std::string name) {
+    return { query_term_t::kind_t::property, std::move(name) };
+}
+
+query_term_t
+property_term(std::string name, compare_t cmp, any_t value) {
+    return { query_term_t::kind_t::property, std::move(name), true, cmp, value };
+}
+
+QueryIndex::QueryIndex(const Program<>& program)
+    :program(program)
+{
+    update();
+}
+
+void
+QueryIndex::update() {
+    std::vector<size_t> old_sizes(properties.size());
+    for (size_t p = 0; p < properties.size(); p++) old_sizes[p] = properties[p].by_value.size();
+
+    for (uint64_t i = n_instructions; i < program.size(); i++) {
+        program[i].for_each_annotation([&] (annotation_handle_t a) {
+            if (a.id >= annotation_positions.size()) annotation_positions.resize(a.id+1);
+            annotation_positions[a.id].push_back(i);
+        });
+        program[i].for_each_property([&] (property_handle_t p, const any_t& v) {
+            if (p.id >= properties.size()) properties.resize(p.id+1);
+            properties[p.id].positions.push_back(i);
+            properties[p.id].by_value.emplace_back(v, i);
+        });
+    }
+    n_instructions = program.size();
+    // Sort the new entries of each value index, and merge them in.
+    for (size_t p = 0; p < properties.size(); p++) {
+        std::vector<value_entry_t>& v = properties[p].by_value;
+        const size_t m = p < old_sizes.size() ? old_sizes[p] : 0;
+        if (v.size() == m) continue;
+        std::sort(v.begin() + m, v.end(), entry_less);
+        std::inplace_merge(v.begin(), v.begin() + m, v.end(), entry_less);
+    }
+}
+
+std::vector<uint64_t>
+QueryIndex::query(const std::vector<query_term_t>& terms) const {
+    std::vector<uint64_t> out;
+    if (terms.empty()) {
+        out.resize(n_instructions);
+        std::iota(out.begin(), out.end(), 0);
+        return out;
+    }
+    std::vector<resolved_term_t> resolved(terms.size());
+    for (size_t k = 0; k < terms.size(); k++) {
+        if (!resolve(terms[k], resolved[k])) return out;
+    }
+    // Start from the most selective term.
+    const size_t best = std::min_element(resolved.begin(), resolved.end(),
+                            [] (const resolved_term_t& x, const resolved_term_t& y) { return x.count < y.count; })
+                        - resolved.begin();
+    const resolved_term_t& r = resolved[best];
+    if (r.positions != nullptr) {
+        out.assign(r.positions, r.positions + r.count);
+    } else {
+        out.reserve(r.count);
+        for (size_t i = 0; i < r.count; i++) out.push_back(r.entries[i].second);
+        std::sort(out.begin(), out.end());
+    }
+    if (resolved.size() == 1) return out;
+    auto it = std::remove_if(out.begin(), out.end(), [&] (uint64_t i) {
+        for (size_t k = 0; k < resolved.size(); k++) {
+            if (k != best && !matches(program[i], resolved[k])) return true;
+        }
+        return false;
+    });
+    out.erase(it, out.end());
+    return out;
+}
+
+uint64_t
+QueryIndex::size() const {
+    return n_instructions;
+}
+
+bool
+QueryIndex::resolve(const query_term_t& t, resolved_term_t& r) const {
+    r.term = &t;
+    if (t.kind == query_term_t::kind_t::annotation) {
+        annotation_handle_t a;
+        if (!find_annotation_handle(t.name, a) || a.id >= annotation_positions.size()) return false;
+        r.id = a.id;
+        r.positions = annotation_positions[a.id].data();
+        r.count = annotation_positions[a.id].size();
+        return r.count > 0;
+    }
+    property_handle_t p;
+    if (!find_property_handle(t.name, p) || p.id >= properties.size()) return false;
+    r.id = p.id;
+    const property_index_t& x = properties[p.id];
+    if (!t.has_value) {
+        r.positions = x.positions.data();
+        r.count = x.positions.size();
+        return r.count > 0;
+    }
+    // Restrict the value index to the values of the same category, and then to
+    // the range that compares.
+    const int cat = get_category(t.value);
+    auto split = std::partition_point(x.by_value.begin(), x.by_value.end(),
+                    [] (const value_entry_t& e) { return get_category(e.first) == 0; });
+    auto begin = cat == 0 ? x.by_value.begin() : split,
+         end = cat == 0 ? split : x.by_value.end();
+    auto lo = std::lower_bound(begin, end, t.value,
+                    [] (const value_entry_t& e, const any_t& v) { return compare_values(e.first, v) < 0; });
+    auto hi = std::upper_bound(lo, end, t.value,
+                    [] (const any_t& v, const value_entry_t& e) { return compare_values(v, e.first) < 0; });
+    switch (t.cmp) {
+    case compare_t::eq: begin = lo; end = hi; break;
+    case compare_t::lt: end = lo;               break;
+    case compare_t::le: end = hi;               break;
+    case compare_t::gt: begin = hi;             break;
+    case compare_t::ge: begin = lo;             break;
+    }
+    r.count = end - begin;
+    if (r.count == 0) return false;
+    r.entries = &*begin;
+    return true;
+}
+
+bool
+QueryIndex::matches(const Instruction<>& inst, const resolved_term_t& r) const {
+    const query_term_t& t = *r.term;
+    if (t.kind == query_term_t::kind_t::annotation) return inst.has_annotation(annotation_handle_t{r.id});
+    const property_handle_t p{r.id};
+    if (!inst.has_property(p)) return false;
+    if (!t.has_value) return true;
+    const any_t v = inst.get_property(p);
+    if (get_category(v) != get_category(t.value)) return false;
+    const int c = compare_values(v, t.value);
+    switch (t.cmp) {
+    case compare_t::eq: return c == 0;
+    case compare_t::lt: return c < 0;
+    case compare_t::le: return c <= 0;
+    case compare_t::gt: return c > 0;
+    case compare_t::ge: return c >= 0;
+    }
+    return false;
+}
+
+}   // qes
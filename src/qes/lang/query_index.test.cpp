@@ -0,0 +1,125 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ *
+ *  Fails if a query of QueryIndex (see qes/lang/query_index.h) does not give
+ *  the same instructions as checking every instruction of the program.
+ * */
+
+#include <qes.h>
+#include <qes/lang/query_index.h>
+
+#include <random>
+
+using namespace qes;
+
+const size_t N_INSTRUCTIONS = 2000;
+const size_t N_QUERIES = 500;
+
+// Properties are integers (round), doubles (rate), strings (kind), or any of
+// them (mixed), so that numbers are compared with each other but not with
+// strings.
+any_t
+make_value(std::mt19937& rng, const std::string& property) {
+    const uint32_t k = property == "mixed" ? rng() % 3 : (property == "round" ? 0 : (property == "rate" ? 1 : 2));
+    if (k == 0) return static_cast<int64_t>(rng() % 10) - 2;
+    if (k == 1) return static_cast<double>(rng() % 20) / 4.0 - 1.0;
+    return std::string(1, "xyz"[rng() % 3]);
+}
+
+const std::vector<std::string> ANNOTATIONS = { "measured", "timing_error", "last" };
+const std::vector<std::string> PROPERTIES = { "round", "rate", "kind", "mixed" };
+
+Program<>
+make_test_program(std::mt19937& rng) {
+    Program<> program;
+    for (size_t i = 0; i < N_INSTRUCTIONS; i++) {
+        Instruction<> inst("cx", std::vector<int64_t>{ static_cast<int64_t>(i % 5) });
+        for (const std::string& a : ANNOTATIONS) {
+            if (rng() % 4 == 0) inst.put(a);
+        }
+        for (const std::string& p : PROPERTIES) {
+            if (rng() % 3 == 0) inst.put(p, make_value(rng, p));
+        }
+        program.push_back(std::move(inst));
+    }
+    return program;
+}
+
+// Returns -1, 0, or 1, or 2 if the values do not compare.
+int
+compare(const any_t& x, const any_t& y) {
+    const bool x_string = holds_alternative<std::string>(x),
+                y_string = holds_alternative<std::string>(y);
+    if (x_string != y_string) return 2;
+    if (x_string) {
+        const int c = get<std::string>(x).compare(get<std::string>(y));
+        return (c > 0) - (c < 0);
+    }
+    auto number = [] (const any_t& v) {
+        return holds_alternative<int64_t>(v) ? static_cast<double>(get<int64_t>(v)) : get<double>(v);
+    };
+    const double a = number(x), b = number(y);
+    return (a > b) - (a < b);
+}
+
+bool
+matches(const Instruction<>& inst, const query_term_t& t) {
+    if (t.kind == query_term_t::kind_t::annotation) return inst.has_annotation(t.name);
+    if (!inst.has_property(t.name)) return false;
+    if (!t.has_value) return true;
+    const int c = compare(inst.get_property(t.name), t.value);
+    if (c == 2) return false;
+    switch (t.cmp) {
+    case compare_t::eq: return c == 0;
+    case compare_t::lt: return c < 0;
+    case compare_t::le: return c <= 0;
+    case compare_t::gt: return c > 0;
+    case compare_t::ge: return c >= 0;
+    }
+    return false;
+}
+
+query_term_t
+make_term(std::mt19937& rng) {
+    if (rng() % 3 == 0) return annotation_term(ANNOTATIONS[rng() % ANNOTATIONS.size()]);
+    const std::string p = PROPERTIES[rng() % PROPERTIES.size()];
+    if (rng() % 4 == 0) return property_term(p);
+    const compare_t cmp[] = { compare_t::eq, compare_t::lt, compare_t::le, compare_t::gt, compare_t::ge };
+    return property_term(p, cmp[rng() % 5], make_value(rng, PROPERTIES[rng() % PROPERTIES.size()]));
+}
+
+// Checks random queries of up to 3 terms against a scan of the instructions
+// that have been indexed.
+bool
+check_queries(const QueryIndex& index, const Program<>& program, std::mt19937& rng) {
+    for (size_t i = 0; i < N_QUERIES; i++) {
+        std::vector<query_term_t> terms;
+        for (size_t j = rng() % 4; j > 0; j--) terms.push_back(make_term(rng));
+        std::vector<uint64_t> expected;
+        for (uint64_t k = 0; k < index.size(); k++) {
+            bool ok = true;
+            for (const query_term_t& t : terms) ok = ok && matches(program[k], t);
+            if (ok) expected.push_back(k);
+        }
+        if (index.query(terms) != expected) {
+            std::cerr << "[ qes ] query " << i << " (" << terms.size() << " terms) does not match a scan." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int main() {
+    std::mt19937 rng(0);
+    const Program<> full = make_test_program(rng);
+    // Index half of the program, and then the rest with update().
+    Program<> program(full.begin(), full.begin() + N_INSTRUCTIONS/2);
+    program.reserve(N_INSTRUCTIONS);
+    QueryIndex index(program);
+    bool ok = check_queries(index, program, rng);
+    program.insert(program.end(), full.begin() + N_INSTRUCTIONS/2, full.end());
+    index.update();
+    ok = ok && index.size() == N_INSTRUCTIONS && check_queries(index, program, rng);
+    return ok ? 0 : 1;
+}
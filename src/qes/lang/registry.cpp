@@ -0,0 +1,120 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/registry.h"
+
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace qes {
+
+namespace {
+
+// A registry of strings. Strings are stored in a deque, so references to them
+// stay valid as the registry grows.
+struct registry_t {
+    std::shared_mutex                           mtx;
+    std::deque<std::string>                     names;
+    std::unordered_map<std::string, uint32_t>   ids;
+
+    uint32_t
+    get_or_add(std::string s) {
+        {
+            std::shared_lock<std::shared_mutex> lk(mtx);
+            auto it = ids.find(s);
+            if (it != ids.end()) return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lk(mtx);
+        auto [ it, added ] = ids.emplace(s, static_cast<uint32_t>(names.size()));
+        if (added) names.push_back(std::move(s));
+        return it->second;
+    }
+
+    bool
+    find(const std::string& s, uint32_t& id) {
+        std::shared_lock<std::shared_mutex> lk(mtx);
+        auto it = ids.find(s);
+        if (it == ids.end()) return false;
+        id = it->second;
+        return true;
+    }
+
+    const std::string&
+    get_name(uint32_t id) {
+        std::shared_lock<std::shared_mutex> lk(mtx);
+        if (id >= names.size()) {
+            std::cerr << "[ qes ] invalid interned string id " << id << "." << std::endl;
+            exit(1);
+        }
+        return names[id];
+    }
+};
+
+// These are created on first use and never freed, so they can be used during
+// static initialization and destruction.
+registry_t&
+annotation_registry() {
+    static registry_t* r = new registry_t;
+    return *r;
+}
+
+registry_t&
+property_registry() {
+    static registry_t* r = new registry_t;
+    return *r;
+}
+
+registry_t&
+string_registry() {
+    static registry_t* r = new registry_t;
+    return *r;
+}
+
+}   // anonymous
+
+annotation_handle_t
+get_annotation_handle(std::string s) {
+    return { annotation_registry().get_or_add(std::move(s)) };
+}
+
+property_handle_t
+get_property_handle(std::string s) {
+    return { property_registry().get_or_add(std::move(s)) };
+}
+
+bool
+find_annotation_handle(const std::string& s, annotation_handle_t& h) {
+    return annotation_registry().find(s, h.id);
+}
+
+bool
+find_property_handle(const std::string& s, property_handle_t& h) {
+    return property_registry().find(s, h.id);
+}
+
+const std::string&
+get_annotation_name(annotation_handle_t h) {
+    return annotation_registry().get_name(h.id);
+}
+
+const std::string&
+get_property_name(property_handle_t h) {
+    return property_registry().get_name(h.id);
+}
+
+uint32_t
+intern_string(const std::string& s) {
+    return string_registry().get_or_add(s);
+}
+
+const std::string&
+get_interned_string(uint32_t id) {
+    return string_registry().get_name(id);
+}
+
+}   // qes
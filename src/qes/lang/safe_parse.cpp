@@ -30,12 +30,22 @@ static const std::map<std::string, void(*)(sptr<QesParseNode>)>
         PUT(instruction),
         PUT(modifier),
         PUT(operands),
-        PUT(anyval)
+        PUT(anyval),
+        PUT(repeat_header),
+        PUT(operands_tail),
+        PUT(expr),
+        PUT(expr_tail),
+        PUT(term),
+        PUT(term_tail),
+        PUT(factor),
+        PUT(params),
+        PUT(params_tail)
     };
 
-Program<>
-safe_read_program(std::istream& fin) {
+static Program<>
+safe_read_program(std::istream& fin, io_stats_t* stats, SourceMap* locations) {
     clear_identifier_refs();
+    clear_subroutines();
     reset_pc();
 #ifndef QES_LEXER_FILE
     exit_macro_does_not_exist("QES_LEXER_FILE");
@@ -48,24 +58,103 @@ safe_read_program(std::istream& fin) {
     test_file_exists(QES_LEXER_FILE, "QES_LEXER_FILE");
     test_file_exists(QES_LL_GRAMMAR_FILE, "QES_LL_GRAMMAR_FILE");
 
+    QES_IF_PROFILE(
+        phase_stats_t* lex_phase = nullptr;
+        phase_stats_t* parse_phase = nullptr;
+        phase_stats_t* rule_phase = nullptr;
+        phase_stats_t* token_phase = nullptr;
+        phase_stats_t* callback_phase = nullptr;
+        phase_stats_t* id_ref_phase = nullptr;
+        if (stats != nullptr) {
+            lex_phase = &stats->get("lex");
+            parse_phase = &stats->get("parse");
+            rule_phase = &stats->get("recv_rule");
+            token_phase = &stats->get("recv_token");
+            callback_phase = &stats->get("callbacks");
+            id_ref_phase = &stats->get("replace_id_refs");
+        }
+    )
+
     QesParseNetwork net;
 
     Lexer qes_lexer(QES_LEXER_FILE);
-    qes_lexer.read_tokens(fin);
+    if (locations != nullptr) qes_lexer.enable_token_positions();
+    {
+        QES_IF_PROFILE(PhaseTimer timer(lex_phase);)
+        qes_lexer.read_tokens(fin);
+    }
+    std::vector<Token> tokens = qes_lexer.get_tokens();
+    std::vector<token_pos_t> positions = qes_lexer.get_token_positions();
+    QES_IF_PROFILE(
+        if (lex_phase != nullptr) {
+            lex_phase->tokens += tokens.size();
+            lex_phase->bytes += qes_lexer.get_number_of_bytes_read();
+        }
+    )
 
     LLParser qes_parser(QES_LL_GRAMMAR_FILE);
-    qes_parser.parse(qes_lexer.get_tokens(), net);
+#ifdef QES_PROFILE
+    if (stats != nullptr) {
+        // The parse phase excludes the time (and allocations) spent in the
+        // callback manager.
+        ProfiledCallbackManager<QesParseNetwork> pnet{net, rule_phase, token_phase};
+        const phase_stats_t prev_rule = *rule_phase,
+                            prev_token = *token_phase;
+        {
+            PhaseTimer timer(parse_phase);
+            qes_parser.parse(tokens, pnet);
+        }
+        parse_phase->wall_time_ns -= (rule_phase->wall_time_ns - prev_rule.wall_time_ns)
+                                    + (token_phase->wall_time_ns - prev_token.wall_time_ns);
+        parse_phase->allocations -= (rule_phase->allocations - prev_rule.allocations)
+                                    + (token_phase->allocations - prev_token.allocations);
+        parse_phase->allocated_bytes -= (rule_phase->allocated_bytes - prev_rule.allocated_bytes)
+                                    + (token_phase->allocated_bytes - prev_token.allocated_bytes);
+        parse_phase->tokens += tokens.size();
+    } else {
+        qes_parser.parse(tokens, net);
+    }
+#else
+    qes_parser.parse(tokens, net);
+#endif
     
     // Now, the parse network should be populated. We simply need to
     // propagate the data.
-    net.apply_callback_bottom_up([&] (sptr<QesParseNode> x)
     {
-        if (!PARSE_FUNCTION_TABLE.count(x->symbol)) return;
-        PARSE_FUNCTION_TABLE.at(x->symbol)(x);
-    });
+        QES_IF_PROFILE(PhaseTimer timer(callback_phase);)
+        if (locations != nullptr) set_token_positions(&positions);
+        net.apply_callback_bottom_up([&] (sptr<QesParseNode> x)
+        {
+            if (!PARSE_FUNCTION_TABLE.count(x->symbol)) return;
+            PARSE_FUNCTION_TABLE.at(x->symbol)(x);
+        });
+        set_token_positions(nullptr);
+    }
     Program<> program = std::move(net.root->data.inst_block);
-    replace_id_refs_with_pc(program);
+    if (locations != nullptr) *locations = std::move(net.root->data.locations);
+    expand_calls(program, locations);
+    {
+        QES_IF_PROFILE(PhaseTimer timer(id_ref_phase);)
+        replace_id_refs_with_pc(program);
+    }
+    check_expressions_evaluated(program);
+    QES_IF_PROFILE(
+        if (callback_phase != nullptr) {
+            callback_phase->instructions += program.size();
+            id_ref_phase->instructions += program.size();
+        }
+    )
     return program;
 }
 
+Program<>
+safe_read_program(std::istream& fin, io_stats_t* stats) {
+    return safe_read_program(fin, stats, nullptr);
+}
+
+Program<>
+safe_read_program(std::istream& fin, SourceMap& locations, io_stats_t* stats) {
+    return safe_read_program(fin, stats, &locations);
+}
+
 }   // qes
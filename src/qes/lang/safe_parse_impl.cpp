@@ -3,8 +3,11 @@
  *  date:   29 January 2024
  * */
 
+#include "qes/lang/module.h"
 #include "qes/lang/safe_parse_impl.h"
 
+#include <algorithm>
+
 namespace qes {
 
 static int64_t PC = 0;
@@ -13,7 +16,25 @@ static const int ID_REF_OFFSET = 48;
 static std::map<std::string, int64_t>   ID_REF_MAP;
 static std::map<int64_t, sptr<int64_t>> ID_REF_PC_MAP;
 
-// Need this struct for std::visit.
+// A call is parsed as an instruction named CALL_PREFIX + the subroutine's name
+// (which cannot be a real instruction name as it has a space), and with the
+// arguments as its operands.
+static const std::string CALL_PREFIX = "call ";
+
+// Subroutines included from a module (see qes/lang/module.h) are kept as they
+// were parsed by the module, and are expanded with expand.
+struct safe_subroutine_t {
+    std::vector<std::string>    params;
+    Program<>                   body;
+
+    std::shared_ptr<const subroutine_t> included;
+};
+
+static std::map<std::string, safe_subroutine_t> SUBROUTINE_MAP;
+
+static const std::vector<token_pos_t>* TOKEN_POSITIONS = nullptr;
+
+// Need this struct for visit.
 template <class... Ts>
 struct overloads : Ts... { using Ts::operator()...; };
 
@@ -61,7 +82,7 @@ void
 replace_id_refs_with_pc(Instruction<>& inst) {
     std::vector<any_t> operands;
     for (any_t op : inst.get_operands()) {
-        std::visit(overloads{
+        visit(overloads{
                 [&] (int64_t x) {
                     if (ID_REF_PC_MAP.count(x)) {
                         operands.emplace_back(PC - *ID_REF_PC_MAP.at(x) - 1);
@@ -77,10 +98,198 @@ replace_id_refs_with_pc(Instruction<>& inst) {
     inst.set_operands(operands);
 }
 
+void
+check_expressions_evaluated(const Program<>& program) {
+    // Identifiers that are not labels are variables, which should have been
+    // substituted.
+    std::map<int64_t, std::string> variables;
+    for (const auto& [ id, ref ] : ID_REF_MAP) {
+        if (!ID_REF_PC_MAP.count(ref)) variables[ref] = id;
+    }
+    for (const Instruction<>& inst : program) {
+        inst.for_each_value([&] (const any_t& x) {
+            if (holds_alternative<int64_t>(x) && variables.count(get<int64_t>(x))) {
+                std::cerr << "[ qes ] variable \"" << variables.at(get<int64_t>(x))
+                    << "\" is not defined." << std::endl;
+                exit(1);
+            }
+            if (!is_expression_ref(x)) return;
+            std::cerr << "[ qes ] expression \"" << print_expression(get_expression(x))
+                << "\" uses an undefined variable." << std::endl;
+            exit(1);
+        });
+    }
+}
+
+// Replaces the variable (on its own or in an expression) by the value.
+static void
+substitute_variable(Instruction<>& inst, const std::string& var, int64_t value) {
+    const int64_t id_ref = get_identifier_ref(var);
+    const uint32_t var_id = intern_string(var);
+    inst.update_values([&] (any_t& v) {
+        if (holds_alternative<int64_t>(v) && get<int64_t>(v) == id_ref) {
+            v = value;
+        } else if (is_expression_ref(v)) {
+            v = substitute(v, var_id, value);
+        }
+    });
+}
+
+static bool
+is_identifier_ref(int64_t x) {
+    for (const auto& [id, ref] : ID_REF_MAP) {
+        if (ref == x) return true;
+    }
+    return false;
+}
+
+static bool
+is_call(const Instruction<>& inst) {
+    return inst.get_name().compare(0, CALL_PREFIX.size(), CALL_PREFIX) == 0;
+}
+
+static void expand_calls_into(const Program<>&, Program<>&, std::vector<std::string>& call_stack);
+
+static void
+expand_call(const Instruction<>& inst, Program<>& out, std::vector<std::string>& call_stack) {
+    const std::string name = inst.get_name().substr(CALL_PREFIX.size());
+    if (!SUBROUTINE_MAP.count(name)) {
+        std::cerr << "[ qes ] subroutine \"" << name << "\" is not defined." << std::endl;
+        exit(1);
+    }
+    if (std::find(call_stack.begin(), call_stack.end(), name) != call_stack.end()) {
+        std::cerr << "[ qes ] subroutine \"" << name << "\" is called recursively." << std::endl;
+        exit(1);
+    }
+    const safe_subroutine_t& sub = SUBROUTINE_MAP.at(name);
+    std::vector<any_t> args = inst.get_operands();
+    if (sub.params.size() != args.size()) {
+        std::cerr << "[ qes ] subroutine \"" << name << "\" takes " << sub.params.size()
+            << " arguments, but " << args.size() << " were given." << std::endl;
+        exit(1);
+    }
+    for (const any_t& x : args) {
+        if (!holds_alternative<int64_t>(x) || is_identifier_ref(get<int64_t>(x))) {
+            std::cerr << "[ qes ] argument " << x << " of a call to subroutine \"" << name
+                << "\" is not an integer." << std::endl;
+            exit(1);
+        }
+    }
+    if (sub.included != nullptr) {
+        block_t call;
+        call.subroutine = sub.included;
+        call.args = std::move(args);
+        Program<> body = expand(call);
+        out.insert(out.end(), std::make_move_iterator(body.begin()), std::make_move_iterator(body.end()));
+        return;
+    }
+    Program<> body(sub.body);
+    for (Instruction<>& y : body) {
+        for (size_t i = 0; i < args.size(); i++) {
+            substitute_variable(y, sub.params[i], get<int64_t>(args[i]));
+        }
+    }
+    call_stack.push_back(name);
+    expand_calls_into(body, out, call_stack);
+    call_stack.pop_back();
+}
+
+static void
+expand_calls_into(const Program<>& program, Program<>& out, std::vector<std::string>& call_stack) {
+    for (const Instruction<>& inst : program) {
+        if (is_call(inst))  expand_call(inst, out, call_stack);
+        else                out.push_back(inst);
+    }
+}
+
+void
+clear_subroutines() {
+    SUBROUTINE_MAP.clear();
+}
+
+void
+expand_calls(Program<>& program, SourceMap* locations) {
+    if (!std::any_of(program.begin(), program.end(), [] (const Instruction<>& inst) { return is_call(inst); })) {
+        return;
+    }
+    Program<> out;
+    std::vector<std::string> call_stack;
+    if (locations == nullptr) {
+        expand_calls_into(program, out, call_stack);
+    } else {
+        SourceMap out_locations;
+        for (size_t i = 0; i < program.size(); i++) {
+            const size_t n = out.size();
+            if (is_call(program[i]))    expand_call(program[i], out, call_stack);
+            else                        out.push_back(program[i]);
+            out_locations.push(locations->get(i), out.size() - n);
+        }
+        *locations = std::move(out_locations);
+    }
+    program = std::move(out);
+}
+
+void
+set_token_positions(const std::vector<token_pos_t>* positions) {
+    TOKEN_POSITIONS = positions;
+}
+
+// Returns the location of the token at the leaf.
+static source_location_t
+get_location(sptr<QesParseNode> x) {
+    const token_pos_t& p = TOKEN_POSITIONS->at(x->token_index);
+    return { p.line, p.col, 0 };
+}
+
 void reset_pc() { PC = 0; }
 int64_t get_pc() { return PC; }
 int64_t increment_pc(int64_t by) { PC += by; return PC; }
 
+// Returns the value of an operand or property value.
+static any_t
+get_expression_value(network_data_t& d) {
+    if (!d.is_compound) return d.anyval;
+    return make_expression_value(std::move(d.expr));
+}
+
+static void
+require_integer_expression(const network_data_t& d) {
+    if (d.expr.empty()) {
+        std::cerr << "[ qes ] value " << d.anyval << " cannot be used in an integer expression." << std::endl;
+        exit(1);
+    }
+}
+
+// For expr and term: the left operand followed by its continuation (if any).
+static void
+join_expression(sptr<QesParseNode> x) {
+    network_data_t& lhs = x->children[0]->data;
+    network_data_t& tail = x->children[1]->data;
+    if (tail.expr.empty()) {
+        x->data.anyval = lhs.anyval;
+        x->data.expr = std::move(lhs.expr);
+        x->data.is_compound = lhs.is_compound;
+        return;
+    }
+    require_integer_expression(lhs);
+    x->data.expr = std::move(lhs.expr);
+    x->data.expr.insert(x->data.expr.end(), tail.expr.begin(), tail.expr.end());
+    x->data.is_compound = true;
+}
+
+// For expr_tail and term_tail: the right operand, the operator, and the rest
+// of the continuation.
+static void
+join_expression_tail(sptr<QesParseNode> x, std::map<std::string, expr_op_t::kind_t> ops) {
+    if (x->children[0]->symbol == T_empty) return;
+    network_data_t& rhs = x->children[1]->data;
+    network_data_t& tail = x->children[2]->data;
+    require_integer_expression(rhs);
+    x->data.expr = std::move(rhs.expr);
+    x->data.expr.push_back({ops.at(x->children[0]->symbol), 0});
+    x->data.expr.insert(x->data.expr.end(), tail.expr.begin(), tail.expr.end());
+}
+
 //
 // Below are all the parsing functions.
 //
@@ -115,27 +324,94 @@ void
 p_start(sptr<QesParseNode> x) {
     if (x->children.empty() || x->children[0]->symbol == T_empty) return;
     Program<> prog;
+    SourceMap locations;
 
     Program<> tail = std::move(x->children.back()->data.inst_block);
-    // Check if the children correspond to a repeat block.
+    x->data.has_definition = x->children.back()->data.has_definition;
+    // Check if the children correspond to a repeat block or a definition.
     bool is_repeat_block = (x->children[0]->symbol == "KW_repeat");
-    if (is_repeat_block) {
+    bool is_definition = (x->children[0]->symbol == "KW_def");
+    bool is_include = (x->children[0]->symbol == "KW_include");
+    if (is_include) {
+        std::shared_ptr<const module_t> m = load_module(get<std::string>(x->children[1]->data.anyval));
+        for (const auto& [ name, sub ] : m->subroutines) {
+            auto it = SUBROUTINE_MAP.find(name);
+            if (it != SUBROUTINE_MAP.end() && it->second.included != sub) {
+                std::cerr << "[ qes ] subroutine \"" << name << "\" (included from \"" << m->path
+                    << "\") is already defined." << std::endl;
+                exit(1);
+            }
+            if (it != SUBROUTINE_MAP.end()) continue;
+            safe_subroutine_t& s = SUBROUTINE_MAP[name];
+            for (uint32_t p : sub->params) s.params.push_back(get_interned_string(p));
+            s.included = sub;
+        }
+        x->data.has_definition |= !m->subroutines.empty();
+
+        block_t call;
+        call.subroutine = m->body;
+        prog = expand(call);
+        increment_pc(prog.size());
+        if (TOKEN_POSITIONS != nullptr) locations.push(get_location(x->children[0]), prog.size());
+    } else if (is_definition) {
+        std::string name = x->children[1]->data.instruction_name;
+        if (x->children[6]->data.has_definition) {
+            std::cerr << "[ qes ] subroutine definitions cannot be nested (in \"" << name << "\")." << std::endl;
+            exit(1);
+        }
+        if (SUBROUTINE_MAP.count(name)) {
+            std::cerr << "[ qes ] subroutine \"" << name << "\" is already defined." << std::endl;
+            exit(1);
+        }
+        SUBROUTINE_MAP[name] = { std::move(x->children[3]->data.params),
+                                    std::move(x->children[6]->data.inst_block) };
+        x->data.has_definition = true;
+    } else if (is_repeat_block) {
         uint64_t n_repeats = x->children[2]->data.repeat_count;
+        std::string var = x->children[2]->data.loop_var;
+        if (x->children[5]->data.has_definition) {
+            std::cerr << "[ qes ] subroutines cannot be defined in a repeat block." << std::endl;
+            exit(1);
+        }
         Program<> blk = std::move(x->children[5]->data.inst_block);
+        if (TOKEN_POSITIONS != nullptr) {
+            for (uint64_t i = 0; i < n_repeats; i++) locations.append(x->children[5]->data.locations, i);
+        }
 
-        while (n_repeats--) {
-            prog.insert(prog.end(), blk.cbegin(), blk.cend());
+        if (var.empty()) {
+            while (n_repeats--) {
+                prog.insert(prog.end(), blk.cbegin(), blk.cend());
+            }
+        } else {
+            // As blocks are expanded bottom-up, we substitute the variable in
+            // each iteration. The variable may appear on its own (as an
+            // identifier ref) or in expressions, which are partially evaluated
+            // if they use the variables of outer blocks.
+            for (uint64_t i = 0; i < n_repeats; i++) {
+                for (const Instruction<>& inst : blk) {
+                    Instruction<> y(inst);
+                    substitute_variable(y, var, static_cast<int64_t>(i));
+                    prog.push_back(std::move(y));
+                }
+            }
         }
     } else {
         // This is just an instruction
         prog.push_back(std::move(x->children[0]->data.inst));
+        if (TOKEN_POSITIONS != nullptr) locations.push(x->children[0]->data.location);
         if (*x->children[0]->data.pc_ptr < 0) {
             *x->children[0]->data.pc_ptr = get_pc();
         }
         increment_pc(1);
     }
-    prog.insert(prog.end(), tail.cbegin(), tail.cend());
+    // The tail is the rest of the program, so it is moved rather than copied
+    // (copying it at every line would allocate quadratically many times).
+    prog.insert(prog.end(), std::make_move_iterator(tail.begin()), std::make_move_iterator(tail.end()));
     x->data.inst_block = std::move(prog);
+    if (TOKEN_POSITIONS != nullptr) {
+        locations.append(x->children.back()->data.locations);
+        x->data.locations = std::move(locations);
+    }
 }
 
 void
@@ -150,6 +426,12 @@ p_line(sptr<QesParseNode> x) {
         // This is a modifier.
         inst = std::move(x->children[2]->data.inst);
         pc_ptr = x->children[2]->data.pc_ptr;
+        x->data.location = x->children[2]->data.location;
+        if (is_call(inst)) {
+            std::cerr << "[ qes ] a call to subroutine \"" << inst.get_name().substr(CALL_PREFIX.size())
+                << "\" cannot have annotations or properties." << std::endl;
+            exit(1);
+        }
         // Update annotations and properties.
         auto mc = x->children[1];
         for (annotation_t a : mc->data.annotation_set)  inst.put(a);
@@ -158,12 +440,14 @@ p_line(sptr<QesParseNode> x) {
         // This is a label and an instruction.
         inst = std::move(x->children[3]->data.inst);
         pc_ptr = x->children[3]->data.pc_ptr;
+        x->data.location = x->children[3]->data.location;
         // Set the label's PC.
-        int64_t id_ref = std::get<int64_t>(x->children[1]->data.anyval);
+        int64_t id_ref = get<int64_t>(x->children[1]->data.anyval);
         set_identifier_ref_pc(id_ref, pc_ptr);
     } else {
         // This is a simple instruction.
         inst = std::move(x->children[0]->data.inst);
+        x->data.location = x->children[0]->data.location;
         // As this is the end of an instruction, give this a unique PC.
         pc_ptr = std::make_shared<int64_t>(-1);
     }
@@ -175,6 +459,16 @@ void
 p_instruction(sptr<QesParseNode> x) {
     auto c1 = x->children[0],
          c2 = x->children[1];
+    if (TOKEN_POSITIONS != nullptr) x->data.location = get_location(c1);
+    if (c2->data.is_call) {
+        if (c1->data.instruction_name != "call") {
+            std::cerr << "[ qes ] instruction \"" << c1->data.instruction_name
+                << "\" cannot take a subroutine call as an operand." << std::endl;
+            exit(1);
+        }
+        x->data.inst = Instruction<>(CALL_PREFIX + c2->data.instruction_name, c2->data.call_args);
+        return;
+    }
     x->data.inst = Instruction<>(c1->data.instruction_name, c2->data.instruction_operands);
 }
 
@@ -185,22 +479,50 @@ p_modifier(sptr<QesParseNode> x) {
     if (x->children[0]->symbol == "KW_annotation") {
         x->data.annotation_set.insert(modifier_name);
     } else {
-        x->data.property_map[modifier_name] = x->children[2]->data.anyval;
+        x->data.property_map[modifier_name] = get_expression_value(x->children[2]->data);
     }
 }
 
 void
 p_operands(sptr<QesParseNode> x) {
-    // Check if this is the first set of operands (no comma) or this is a later set. Also
-    // make sure the first children is not empty (in which case we do nothing).
+    // Make sure the first children is not empty (in which case we do nothing).
     if (x->children[0]->symbol == T_empty) return;
+    p_operands_tail(x);
+}
+
+void
+p_operands_tail(sptr<QesParseNode> x) {
+    // Check if this is the first operand (no comma) or this is a later operand.
+    if (x->children[0]->symbol == T_empty) return;
+    if (x->children[0]->symbol == "(") {
+        // These are the arguments of a call.
+        if (x->children[1]->data.is_call) {
+            std::cerr << "[ qes ] the arguments of a call cannot be calls." << std::endl;
+            exit(1);
+        }
+        x->data.is_call = true;
+        x->data.call_args = std::move(x->children[1]->data.instruction_operands);
+        return;
+    }
 
     std::vector<any_t> operands;
 
     size_t off = (x->children[0]->symbol == ",") ? 1 : 0;
+    if (x->children[1+off]->data.is_call) {
+        // Only the first operand can be the name of a subroutine.
+        const network_data_t& callee = x->children[off]->data;
+        if (off == 1 || callee.is_compound || callee.expr.size() != 1 || callee.expr[0].kind != expr_op_t::VAR) {
+            std::cerr << "[ qes ] arguments must follow the name of the subroutine in a call." << std::endl;
+            exit(1);
+        }
+        x->data.is_call = true;
+        x->data.instruction_name = get_interned_string(static_cast<uint32_t>(callee.expr[0].value));
+        x->data.call_args = std::move(x->children[1+off]->data.call_args);
+        return;
+    }
     std::vector<any_t> tail = std::move(x->children[1+off]->data.instruction_operands);
 
-    operands.push_back(x->children[off]->data.anyval);
+    operands.push_back(get_expression_value(x->children[off]->data));
     operands.insert(operands.end(), tail.begin(), tail.end());
     x->data.instruction_operands = std::move(operands);
 }
@@ -209,6 +531,83 @@ void
 p_anyval(sptr<QesParseNode> x) {
     // Just pass the child into anyval.
     x->data.anyval = x->children[0]->data.anyval;
+    // Integers and identifiers may also be used in expressions.
+    if (x->children[0]->symbol == "I_LITERAL") {
+        x->data.expr = { {expr_op_t::CONST, get<int64_t>(x->data.anyval)} };
+    } else if (x->children[0]->symbol == "IDENTIFIER") {
+        x->data.expr = { {expr_op_t::VAR, intern_string(x->children[0]->data.instruction_name)} };
+    }
+}
+
+void
+p_repeat_header(sptr<QesParseNode> x) {
+    x->data.repeat_count = x->children.back()->data.repeat_count;
+    if (x->children[0]->symbol == "IDENTIFIER") {
+        x->data.loop_var = x->children[0]->data.instruction_name;
+    }
+}
+
+void
+p_expr(sptr<QesParseNode> x) {
+    join_expression(x);
+}
+
+void
+p_expr_tail(sptr<QesParseNode> x) {
+    join_expression_tail(x, {{"+", expr_op_t::ADD}, {"-", expr_op_t::SUB}});
+}
+
+void
+p_term(sptr<QesParseNode> x) {
+    join_expression(x);
+}
+
+void
+p_term_tail(sptr<QesParseNode> x) {
+    join_expression_tail(x, {{"STAR", expr_op_t::MUL}, {"/", expr_op_t::DIV}, {"%", expr_op_t::MOD}});
+}
+
+void
+p_factor(sptr<QesParseNode> x) {
+    auto c = x->children;
+    if (c[0]->symbol == "(") {
+        x->data.anyval = c[1]->data.anyval;
+        x->data.expr = std::move(c[1]->data.expr);
+        x->data.is_compound = c[1]->data.is_compound;
+    } else if (c[0]->symbol == "-") {
+        // Floats are negated directly, as expressions only support integers.
+        if (!c[1]->data.is_compound && holds_alternative<double>(c[1]->data.anyval)) {
+            x->data.anyval = -get<double>(c[1]->data.anyval);
+            return;
+        }
+        require_integer_expression(c[1]->data);
+        x->data.expr = std::move(c[1]->data.expr);
+        x->data.expr.push_back({expr_op_t::NEG, 0});
+        x->data.is_compound = true;
+    } else {
+        x->data.anyval = c[0]->data.anyval;
+        x->data.expr = std::move(c[0]->data.expr);
+    }
+}
+
+void
+p_params(sptr<QesParseNode> x) {
+    if (x->children[0]->symbol == T_empty) return;
+    p_params_tail(x);
+}
+
+void
+p_params_tail(sptr<QesParseNode> x) {
+    if (x->children[0]->symbol == T_empty) return;
+    size_t off = (x->children[0]->symbol == ",") ? 1 : 0;
+    std::string p = x->children[off]->data.instruction_name;
+    std::vector<std::string> tail = std::move(x->children[1+off]->data.params);
+    if (std::find(tail.begin(), tail.end(), p) != tail.end()) {
+        std::cerr << "[ qes ] parameter \"" << p << "\" is repeated." << std::endl;
+        exit(1);
+    }
+    x->data.params.push_back(std::move(p));
+    x->data.params.insert(x->data.params.end(), tail.begin(), tail.end());
 }
 
 }   // qes
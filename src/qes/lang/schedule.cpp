@@ -0,0 +1,114 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/qubit_index.h"
+#include "qes/lang/schedule.h"
+
+#include <algorithm>
+
+namespace qes {
+
+size_t
+asap_schedule_t::get_number_of_layers() const {
+    return layer_offsets.empty() ? 0 : layer_offsets.size()-1;
+}
+
+// Computes the layer of each instruction as it is given, and then builds the
+// CSR layers once all instructions have been seen.
+class AsapScheduler {
+public:
+    AsapScheduler(size_t n_instructions)
+        :duration(get_property_handle("duration"))
+    {
+        sch.layer.reserve(n_instructions);
+    }
+
+    void
+    add(const Instruction<>& inst) {
+        double d = 1.0;
+        if (inst.has_property(duration)) {
+            any_t x = inst.get_property(duration);
+            if (holds_alternative<int64_t>(x))      d = static_cast<double>(get<int64_t>(x));
+            else if (holds_alternative<double>(x))  d = get<double>(x);
+            else {
+                std::cerr << "[ qes ] duration " << x << " of instruction \"" << inst.get_name()
+                    << "\" is not a number." << std::endl;
+                exit(1);
+            }
+        }
+        // The instruction starts once all of its qubits are free.
+        uint32_t l = 0;
+        double t = 0.0;
+        const size_t n = inst.get_number_of_operands();
+        for (size_t i = 0; i < n; i++) {
+            int64_t q;
+            if (!get_qubit(inst, i, q)) continue;
+            if (static_cast<size_t>(q) >= layer_frontier.size()) {
+                test_qubit_is_supported(q);
+                layer_frontier.resize(q+1, 0);
+                time_frontier.resize(q+1, 0.0);
+            }
+            l = std::max(l, layer_frontier[q]);
+            t = std::max(t, time_frontier[q]);
+        }
+        t += d;
+        for (size_t i = 0; i < n; i++) {
+            int64_t q;
+            if (!get_qubit(inst, i, q)) continue;
+            layer_frontier[q] = l+1;
+            time_frontier[q] = t;
+        }
+        sch.layer.push_back(l);
+        sch.critical_path_length = std::max(sch.critical_path_length, t);
+        n_layers = std::max(n_layers, l+1);
+    }
+
+    asap_schedule_t
+    finish() {
+        // Counting sort of the instructions by layer (which keeps them in
+        // program order within each layer).
+        sch.layer_offsets.assign(n_layers+1, 0);
+        for (uint32_t l : sch.layer) sch.layer_offsets[l+1]++;
+        for (size_t k = 0; k < n_layers; k++) sch.layer_offsets[k+1] += sch.layer_offsets[k];
+        sch.instructions.resize(sch.layer.size());
+        std::vector<uint64_t> next(sch.layer_offsets.begin(), sch.layer_offsets.end()-1);
+        for (uint64_t i = 0; i < sch.layer.size(); i++) {
+            sch.instructions[next[sch.layer[i]]++] = i;
+        }
+        return std::move(sch);
+    }
+private:
+    static bool
+    get_qubit(const Instruction<>& inst, size_t i, int64_t& q) {
+        any_t x = inst.get(i);
+        if (!holds_alternative<int64_t>(x)) return false;
+        q = get<int64_t>(x);
+        return q >= 0;
+    }
+
+    const property_handle_t duration;
+
+    std::vector<uint32_t>   layer_frontier;
+    std::vector<double>     time_frontier;
+    uint32_t                n_layers = 0;
+
+    asap_schedule_t sch;
+};
+
+asap_schedule_t
+asap_schedule(const Program<>& program) {
+    AsapScheduler s(program.size());
+    for (const Instruction<>& inst : program) s.add(inst);
+    return s.finish();
+}
+
+asap_schedule_t
+asap_schedule(const block_t& blk) {
+    AsapScheduler s(get_expanded_size(blk));
+    for_each_expanded(blk, [&] (Instruction<>&& inst) { s.add(inst); });
+    return s.finish();
+}
+
+}   // qes
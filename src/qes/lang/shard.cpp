@@ -0,0 +1,238 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/fast_parse.h"
+#include "qes/lang/shard.h"
+#include "qes/util/compression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace qes {
+
+namespace fs = std::filesystem;
+
+static const int64_t MANIFEST_VERSION = 1;
+
+static bool
+get_first_qubit(const Instruction<>& inst, int64_t& q) {
+    const size_t n = inst.get_number_of_operands();
+    for (size_t i = 0; i < n; i++) {
+        any_t x = inst.get(i);
+        if (holds_alternative<int64_t>(x) && get<int64_t>(x) >= 0) {
+            q = get<int64_t>(x);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Calls f(k) for k = 0, 1, ..., n_tasks-1 on up to n_threads threads.
+template <class FUNC> static void
+run_in_parallel(size_t n_tasks, size_t n_threads, FUNC f) {
+    if (n_threads == 0) n_threads = std::max(1u, std::thread::hardware_concurrency());
+    n_threads = std::min(n_threads, n_tasks);
+    std::atomic<size_t> next{0};
+    auto worker = [&] () {
+        for (size_t k = next++; k < n_tasks; k = next++) f(k);
+    };
+    if (n_threads <= 1) {
+        worker();
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < n_threads; i++) threads.emplace_back(worker);
+    for (auto& t : threads) t.join();
+}
+
+partitioner_t
+range_partitioner(size_t n_shards) {
+    return { n_shards, [n_shards] (const Instruction<>&, uint64_t pos, uint64_t size) {
+        return static_cast<size_t>(static_cast<__uint128_t>(pos) * n_shards / size);
+    } };
+}
+
+partitioner_t
+qubit_group_partitioner(std::vector<size_t> shard_of_qubit) {
+    size_t n_shards = 0;
+    for (size_t k : shard_of_qubit) n_shards = std::max(n_shards, k+1);
+    size_t prev = 0;
+    auto f = [shard_of_qubit = std::move(shard_of_qubit), prev] (const Instruction<>& inst, uint64_t pos, uint64_t)
+        mutable
+    {
+        if (pos == 0) prev = 0;
+        int64_t q;
+        if (!get_first_qubit(inst, q)) return prev;
+        if (static_cast<uint64_t>(q) >= shard_of_qubit.size()) {
+            std::cerr << "[ qes ] qubit " << q << " of instruction \"" << inst.get_name()
+                << "\" is not assigned to a shard." << std::endl;
+            exit(1);
+        }
+        return prev = shard_of_qubit[q];
+    };
+    return { n_shards, std::move(f) };
+}
+
+partitioner_t
+qubit_group_partitioner(int64_t group_size, size_t n_shards) {
+    if (group_size <= 0) {
+        std::cerr << "[ qes ] qubit groups must have at least one qubit." << std::endl;
+        exit(1);
+    }
+    size_t prev = 0;
+    auto f = [group_size, n_shards, prev] (const Instruction<>& inst, uint64_t pos, uint64_t) mutable {
+        if (pos == 0) prev = 0;
+        int64_t q;
+        if (!get_first_qubit(inst, q)) return prev;
+        return prev = static_cast<size_t>(q / group_size) % n_shards;
+    };
+    return { n_shards, std::move(f) };
+}
+
+shard_manifest_t
+partition_program(const Program<>& program, const partitioner_t& p) {
+    if (p.n_shards == 0) {
+        std::cerr << "[ qes ] a program must be partitioned into at least one shard." << std::endl;
+        exit(1);
+    }
+    shard_manifest_t m;
+    m.n_instructions = program.size();
+    m.sizes.assign(p.n_shards, 0);
+    for (uint64_t i = 0; i < program.size(); i++) {
+        const size_t k = p.get_shard(program[i], i, program.size());
+        if (k >= p.n_shards) {
+            std::cerr << "[ qes ] instruction " << i << " was assigned to shard " << k
+                << ", but there are only " << p.n_shards << " shards." << std::endl;
+            exit(1);
+        }
+        if (!m.runs.empty() && m.runs.back().shard == k) m.runs.back().count++;
+        else                                              m.runs.push_back({k, 1});
+        m.sizes[k]++;
+    }
+    return m;
+}
+
+shard_manifest_t
+write_shards(std::string prefix, const Program<>& program, const partitioner_t& p, write_mode_t mode, size_t n_threads) {
+    shard_manifest_t m = partition_program(program, p);
+    const size_t n_shards = m.sizes.size();
+    // The (start, count) ranges of the program in each shard.
+    std::vector<std::vector<std::pair<uint64_t, uint64_t>>> ranges(n_shards);
+    uint64_t pos = 0;
+    for (const shard_run_t& r : m.runs) {
+        ranges[r.shard].emplace_back(pos, r.count);
+        pos += r.count;
+    }
+    const std::string base = fs::path(prefix).filename().string();
+    for (size_t k = 0; k < n_shards; k++) m.files.push_back(base + "." + std::to_string(k) + ".qes");
+
+    run_in_parallel(n_shards, n_threads, [&] (size_t k) {
+        Program<> shard;
+        shard.reserve(m.sizes[k]);
+        for (auto [ start, count ] : ranges[k]) {
+            shard.insert(shard.end(), program.begin() + start, program.begin() + start + count);
+        }
+        compressed_ofstream fout(prefix + "." + std::to_string(k) + ".qes");
+        if (mode == write_mode_t::flat) write_prog(fout, shard, 1);
+        else                            write_rerolled_prog(fout, shard);
+        fout << std::endl;
+    });
+    write_manifest(prefix + ".manifest", m);
+    return m;
+}
+
+void
+write_manifest(std::string file, const shard_manifest_t& m) {
+    std::ofstream fout(file);
+    fout << "qes_manifest " << MANIFEST_VERSION << "\n"
+        << "instructions " << m.n_instructions << "\n";
+    for (size_t k = 0; k < m.files.size(); k++) {
+        fout << "shard " << k << " " << m.files[k] << " " << m.sizes[k] << "\n";
+    }
+    for (const shard_run_t& r : m.runs) fout << "run " << r.shard << " " << r.count << "\n";
+}
+
+static void
+exit_invalid_manifest(const std::string& file, const std::string& why) {
+    std::cerr << "[ qes ] invalid manifest \"" << file << "\": " << why << "." << std::endl;
+    exit(1);
+}
+
+shard_manifest_t
+read_manifest(std::string file) {
+    std::ifstream fin(file);
+    if (!fin.good()) {
+        std::cerr << "[ qes ] could not read manifest \"" << file << "\"." << std::endl;
+        exit(1);
+    }
+    shard_manifest_t m;
+    std::string key;
+    int64_t version;
+    if (!(fin >> key >> version) || key != "qes_manifest") exit_invalid_manifest(file, "missing header");
+    if (version != MANIFEST_VERSION) exit_invalid_manifest(file, "unknown version " + std::to_string(version));
+    if (!(fin >> key >> m.n_instructions) || key != "instructions") {
+        exit_invalid_manifest(file, "missing number of instructions");
+    }
+    while (fin >> key) {
+        if (key == "shard") {
+            size_t k;
+            std::string f;
+            uint64_t size;
+            if (!(fin >> k >> f >> size) || k != m.files.size()) exit_invalid_manifest(file, "bad shard");
+            m.files.push_back(f);
+            m.sizes.push_back(size);
+        } else if (key == "run") {
+            shard_run_t r;
+            if (!(fin >> r.shard >> r.count) || r.shard >= m.files.size()) exit_invalid_manifest(file, "bad run");
+            m.runs.push_back(r);
+        } else {
+            exit_invalid_manifest(file, "unknown entry \"" + key + "\"");
+        }
+    }
+    // The runs must cover each shard exactly.
+    std::vector<uint64_t> covered(m.files.size(), 0);
+    uint64_t n = 0;
+    for (const shard_run_t& r : m.runs) {
+        covered[r.shard] += r.count;
+        n += r.count;
+    }
+    if (covered != m.sizes || n != m.n_instructions) exit_invalid_manifest(file, "runs do not match the shards");
+    return m;
+}
+
+Program<>
+read_shards(std::string manifest_file, size_t n_threads) {
+    shard_manifest_t m = read_manifest(manifest_file);
+    const fs::path dir = fs::path(manifest_file).parent_path();
+    std::vector<Program<>> shards(m.files.size());
+    run_in_parallel(m.files.size(), n_threads, [&] (size_t k) {
+        const std::string f = (dir / m.files[k]).string();
+        compressed_ifstream fin(f);
+        if (!fin.good()) {
+            std::cerr << "[ qes ] could not read shard \"" << f << "\"." << std::endl;
+            exit(1);
+        }
+        shards[k] = fast_read_program(fin);
+        if (shards[k].size() != m.sizes[k]) {
+            std::cerr << "[ qes ] shard \"" << f << "\" has " << shards[k].size()
+                << " instructions, but the manifest says " << m.sizes[k] << "." << std::endl;
+            exit(1);
+        }
+    });
+    Program<> program;
+    program.reserve(m.n_instructions);
+    std::vector<uint64_t> next(shards.size(), 0);
+    for (const shard_run_t& r : m.runs) {
+        auto it = shards[r.shard].begin() + next[r.shard];
+        program.insert(program.end(), std::make_move_iterator(it), std::make_move_iterator(it + r.count));
+        next[r.shard] += r.count;
+    }
+    return program;
+}
+
+}   // qes
@@ -0,0 +1,68 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ *
+ *  Fails if a program written to shards (see qes/lang/shard.h) does not read
+ *  back as the same program, for each partitioner and write mode.
+ * */
+
+#include <qes.h>
+
+#include <filesystem>
+#include <sstream>
+
+#include <unistd.h>
+
+using namespace qes;
+namespace fs = std::filesystem;
+
+// A program with periodic runs (which rerolled shards write as repeat blocks),
+// instructions without qubits, double operands, annotations, and properties.
+Program<>
+make_test_program(void) {
+    std::ostringstream out;
+    for (int i = 0; i < 200; i++) {
+        if (i % 7 == 0) out << "@annotation timing_error\n";
+        if (i % 11 == 0) out << "@property round " << i / 11 << "\n";
+        // Doubles must read back exactly, and not as integers.
+        if (i % 17 == 0) out << "@property duration " << i / 17 << ".0\nrz " << i % 13 << ", 0.1234567890123" << i << ";\n";
+        out << "cx " << i % 13 << ", " << (i+5) % 13 << ";\n";
+        if (i % 50 == 0) out << "barrier;\nrepeat (20) { h " << i % 13 << "; measure " << i % 13 << "; }\n";
+    }
+    std::istringstream in(out.str());
+    return fast_read_program(in);
+}
+
+int main() {
+    const fs::path dir = fs::temp_directory_path() / ("qes_shard_test." + std::to_string(getpid()));
+    fs::create_directories(dir);
+    const Program<> program = make_test_program();
+
+    std::vector<size_t> shard_of_qubit;
+    for (size_t q = 0; q < 13; q++) shard_of_qubit.push_back(q % 3);
+    const std::vector<std::pair<std::string, partitioner_t>> partitioners = {
+        { "range(1)", range_partitioner(1) },
+        { "range(4)", range_partitioner(4) },
+        // More shards than instructions, so some shards are empty.
+        { "range(2000)", range_partitioner(2000) },
+        { "qubit_group(shard_of_qubit)", qubit_group_partitioner(shard_of_qubit) },
+        { "qubit_group(2, 3)", qubit_group_partitioner(2, 3) }
+    };
+
+    bool ok = true;
+    for (const auto& [ name, p ] : partitioners) {
+        for (write_mode_t mode : { write_mode_t::flat, write_mode_t::rerolled }) {
+            const std::string prefix = (dir / "program").string();
+            to_files(prefix, program, p, mode);
+            if (from_files(prefix + ".manifest") != program) {
+                std::cerr << "[ qes ] the shards of " << name << " (" << (mode == write_mode_t::flat ? "flat" : "rerolled")
+                    << ") do not read back as the program written." << std::endl;
+                ok = false;
+            }
+            fs::remove_all(dir);
+            fs::create_directories(dir);
+        }
+    }
+    fs::remove_all(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/source_map.h"
+
+#include <algorithm>
+
+namespace qes {
+
+static void
+put_varint(std::vector<uint8_t>& out, uint64_t x) {
+    while (x >= 0x80) {
+        out.push_back(static_cast<uint8_t>(x) | 0x80);
+        x >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(x));
+}
+
+static uint64_t
+get_varint(const uint8_t*& p) {
+    uint64_t x = 0;
+    for (int shift = 0; ; shift += 7) {
+        const uint8_t b = *p++;
+        x |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) return x;
+    }
+}
+
+// The deltas are taken modulo 2^64, and zigzagged so that small negative
+// deltas (i.e., going back to the start of a repeat block) are short.
+static void
+put_delta(std::vector<uint8_t>& out, uint64_t from, uint64_t to) {
+    const int64_t d = static_cast<int64_t>(to - from);
+    put_varint(out, (static_cast<uint64_t>(d) << 1) ^ static_cast<uint64_t>(d >> 63));
+}
+
+static uint64_t
+get_delta(const uint8_t*& p, uint64_t from) {
+    const uint64_t z = get_varint(p);
+    return from + ((z >> 1) ^ (~(z & 1) + 1));
+}
+
+template <class FUNC> void
+SourceMap::for_each_run(FUNC f) const {
+    const uint8_t* p = data.data();
+    source_location_t loc;
+    for (uint64_t r = 0; r < n_closed_runs; r++) {
+        const uint64_t count = get_varint(p);
+        loc.line = get_delta(p, loc.line);
+        loc.col = get_delta(p, loc.col);
+        loc.iteration = get_delta(p, loc.iteration);
+        f(loc, count);
+    }
+    if (curr_count > 0) f(curr, curr_count);
+}
+
+void
+SourceMap::push(const source_location_t& loc, uint64_t count) {
+    if (count == 0) return;
+    if (curr_count > 0 && loc == curr) {
+        curr_count += count;
+        return;
+    }
+    close_run();
+    curr = loc;
+    curr_count = count;
+}
+
+void
+SourceMap::append(const SourceMap& other) {
+    other.for_each_run([&] (const source_location_t& loc, uint64_t count) { push(loc, count); });
+}
+
+void
+SourceMap::append(const SourceMap& other, uint64_t iteration) {
+    other.for_each_run([&] (source_location_t loc, uint64_t count) {
+        loc.iteration = iteration;
+        push(loc, count);
+    });
+}
+
+source_location_t
+SourceMap::get(uint64_t k) const {
+    if (k >= n_closed_instructions) return curr;
+    // Find the last checkpoint at or before k.
+    auto it = std::upper_bound(checkpoints.begin(), checkpoints.end(), k,
+                    [] (uint64_t k, const checkpoint_t& c) { return k < c.first_instruction; });
+    const checkpoint_t& c = *(it-1);
+    const uint8_t* p = data.data() + c.offset;
+    source_location_t loc = c.prev;
+    uint64_t i = c.first_instruction;
+    while (true) {
+        const uint64_t count = get_varint(p);
+        loc.line = get_delta(p, loc.line);
+        loc.col = get_delta(p, loc.col);
+        loc.iteration = get_delta(p, loc.iteration);
+        if (k < i + count) return loc;
+        i += count;
+    }
+}
+
+uint64_t
+SourceMap::size() const {
+    return n_closed_instructions + curr_count;
+}
+
+size_t
+SourceMap::get_memory_usage() const {
+    return data.size() + checkpoints.size()*sizeof(checkpoint_t);
+}
+
+void
+SourceMap::close_run() {
+    if (curr_count == 0) return;
+    if (n_closed_runs % CHECKPOINT_INTERVAL == 0) {
+        checkpoints.push_back({n_closed_instructions, data.size(), last_closed});
+    }
+    put_varint(data, curr_count);
+    put_delta(data, last_closed.line, curr.line);
+    put_delta(data, last_closed.col, curr.col);
+    put_delta(data, last_closed.iteration, curr.iteration);
+    n_closed_runs++;
+    n_closed_instructions += curr_count;
+    last_closed = curr;
+    curr_count = 0;
+}
+
+}   // qes
@@ -0,0 +1,113 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/stats.h"
+
+#include <algorithm>
+
+namespace qes {
+
+program_stats_t&
+program_stats_t::operator+=(const program_stats_t& other) {
+    n_instructions += other.n_instructions;
+    n_operands += other.n_operands;
+    max_qubit = std::max(max_qubit, other.max_qubit);
+    for (const auto& [k, n] : other.gate_counts)        gate_counts[k] += n;
+    for (const auto& [k, n] : other.annotation_counts)  annotation_counts[k] += n;
+    for (const auto& [k, n] : other.property_counts)    property_counts[k] += n;
+    return *this;
+}
+
+program_stats_t&
+program_stats_t::operator*=(uint64_t k) {
+    if (k == 0) {
+        // None of the instructions are executed.
+        *this = program_stats_t();
+        return *this;
+    }
+    n_instructions *= k;
+    n_operands *= k;
+    for (auto& p : gate_counts)         p.second *= k;
+    for (auto& p : annotation_counts)   p.second *= k;
+    for (auto& p : property_counts)     p.second *= k;
+    return *this;
+}
+
+static program_stats_t
+program_stats(const block_t& blk, std::vector<var_range_t>& ranges) {
+    // Each block is visited once: the counts of the body are computed first,
+    // and then scaled by the repeat count.
+    program_stats_t stats;
+    if (blk.repeat_count <= 0) return stats;
+
+    // Parameters of a call take the range of values of their arguments.
+    const size_t n = ranges.size();
+    if (blk.subroutine != nullptr) {
+        std::vector<var_range_t> params;
+        for (size_t i = 0; i < blk.args.size(); i++) {
+            const any_t& x = blk.args[i];
+            auto [ lo, hi ] = is_expression_ref(x)
+                                ? get_range(get_expression(x), ranges)
+                                : std::make_pair(get<int64_t>(x), get<int64_t>(x));
+            params.push_back({blk.subroutine->params[i], lo, hi});
+        }
+        ranges.insert(ranges.end(), params.begin(), params.end());
+    }
+    if (blk.loop_var != block_t::NO_LOOP_VAR) ranges.push_back({blk.loop_var, 0, blk.repeat_count-1});
+    for_each_statement(blk,
+        [&] (const Instruction<>& inst) {
+            add_instruction(stats, inst);
+            // The operands of an expression are maximized over the ranges of
+            // the variables.
+            for (const any_t& x : inst.get_operands()) {
+                if (!is_expression_ref(x)) continue;
+                stats.max_qubit = std::max(stats.max_qubit, get_range(get_expression(x), ranges).second);
+            }
+        },
+        [&] (const block_t& sub) { stats += program_stats(sub, ranges); });
+    ranges.resize(n);
+    stats *= static_cast<uint64_t>(blk.repeat_count);
+    return stats;
+}
+
+program_stats_t
+program_stats(const block_t& blk) {
+    std::vector<var_range_t> ranges;
+    return program_stats(blk, ranges);
+}
+
+program_stats_t
+program_stats(const Program<>& prog) {
+    program_stats_t stats;
+    for (const Instruction<>& inst : prog) add_instruction(stats, inst);
+    return stats;
+}
+
+void
+add_instruction(program_stats_t& stats, const Instruction<>& inst) {
+    stats.n_instructions++;
+    stats.gate_counts[inst.get_name()]++;
+    for (const any_t& x : inst.get_operands()) {
+        stats.n_operands++;
+        if (holds_alternative<int64_t>(x)) {
+            stats.max_qubit = std::max(stats.max_qubit, get<int64_t>(x));
+        }
+    }
+    for (const annotation_t& a : inst.get_annotations())    stats.annotation_counts[a]++;
+    for (const auto& p : inst.get_property_map())           stats.property_counts[p.first]++;
+}
+
+std::ostream&
+operator<<(std::ostream& out, const program_stats_t& stats) {
+    out << "instructions: " << stats.n_instructions
+        << "\noperands: " << stats.n_operands
+        << "\nmax qubit: " << stats.max_qubit;
+    for (const auto& [k, n] : stats.gate_counts)        out << "\ngate " << k << ": " << n;
+    for (const auto& [k, n] : stats.annotation_counts)  out << "\nannotation " << k << ": " << n;
+    for (const auto& [k, n] : stats.property_counts)    out << "\nproperty " << k << ": " << n;
+    return out;
+}
+
+}   // qes
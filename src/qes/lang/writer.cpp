@@ -0,0 +1,230 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/writer.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+namespace qes {
+
+// The candidate periods at a position are the distances to the next
+// REROLL_MAX_CANDIDATES occurrences of the same statement.
+static const size_t REROLL_MAX_CANDIDATES = 32;
+
+// Polynomial hashes modulo the Mersenne prime 2^61-1.
+static const uint64_t HASH_MOD = (1ull << 61) - 1;
+static const uint64_t HASH_BASE = 0x1f2e3d4c5b6a7988ull % HASH_MOD;
+
+static inline uint64_t
+mul_mod(uint64_t a, uint64_t b) {
+    __uint128_t x = static_cast<__uint128_t>(a) * b;
+    uint64_t y = static_cast<uint64_t>(x & HASH_MOD) + static_cast<uint64_t>(x >> 61);
+    return y >= HASH_MOD ? y - HASH_MOD : y;
+}
+
+// The program is re-rolled over a sequence of statement ids: equal ids are
+// structurally equal statements. A statement is an instruction of the program
+// or a repeat block of other statements.
+class Reroller {
+public:
+    Reroller(const Program<>& program)
+        :program(program)
+    {}
+
+    block_t
+    run() {
+        // Instructions are given ids by structural equality (i.e., operator==).
+        std::unordered_map<const Instruction<>*, uint64_t, inst_ptr_hash_t, inst_ptr_eq_t> inst_ids;
+        std::vector<uint64_t> seq;
+        seq.reserve(program.size());
+        for (const Instruction<>& inst : program) {
+            auto [ it, is_new ] = inst_ids.try_emplace(&inst, nodes.size());
+            if (is_new) nodes.push_back({&inst, 1, {}});
+            seq.push_back(it->second);
+        }
+        // Each pass rolls up periodic runs of the previous pass's statements, so
+        // a later pass can find the period of a run whose body has many copies
+        // of the same statement.
+        while (true) {
+            const size_t n = seq.size();
+            seq = reroll(seq);
+            if (seq.size() == n) break;
+        }
+        return make_block(seq, 1);
+    }
+private:
+    struct node_t {
+        const Instruction<>*    inst;   // Null if this is a repeat block.
+        int64_t                 repeat_count;
+        std::vector<uint64_t>   body;
+    };
+
+    struct inst_ptr_hash_t {
+        size_t operator()(const Instruction<>* x) const { return hash_inst(*x); }
+    };
+
+    struct inst_ptr_eq_t {
+        bool operator()(const Instruction<>* x, const Instruction<>* y) const { return *x == *y; }
+    };
+
+    // Returns the sequence with its periodic runs replaced by repeat blocks.
+    std::vector<uint64_t>
+    reroll(const std::vector<uint64_t>& seq) {
+        const size_t n = seq.size();
+        // Prefix hashes, so that the hash of any range takes O(1) time.
+        if (pow.size() < n+1) {
+            pow.resize(n+1);
+            pow[0] = 1;
+            for (size_t i = 1; i <= n; i++) pow[i] = mul_mod(pow[i-1], HASH_BASE);
+        }
+        std::vector<uint64_t> prefix(n+1, 0);
+        for (size_t i = 0; i < n; i++) {
+            prefix[i+1] = mul_mod(prefix[i], HASH_BASE) + (seq[i] % HASH_MOD) + 1;
+            if (prefix[i+1] >= HASH_MOD) prefix[i+1] -= HASH_MOD;
+        }
+        auto range_hash = [&] (size_t i, size_t len) {
+            uint64_t h = prefix[i+len] + HASH_MOD - mul_mod(prefix[i], pow[len]);
+            return h >= HASH_MOD ? h - HASH_MOD : h;
+        };
+        // next[i] is the next position with the same statement as i.
+        std::vector<size_t> next(n, n);
+        {
+            std::unordered_map<uint64_t, size_t> last;
+            for (size_t i = n; i-- > 0;) {
+                auto it = last.find(seq[i]);
+                if (it != last.end()) next[i] = it->second;
+                last[seq[i]] = i;
+            }
+        }
+
+        std::vector<uint64_t> out;
+        size_t i = 0;
+        while (i < n) {
+            // Find the period that covers the most statements.
+            size_t best_p = 0, best_k = 1;
+            size_t j = next[i];
+            for (size_t c = 0; c < REROLL_MAX_CANDIDATES && j < n; c++, j = next[j]) {
+                const size_t p = j - i;
+                if (i + 2*p > n) break;
+                const uint64_t h = range_hash(i, p);
+                size_t k = 1;
+                while (i + (k+1)*p <= n && range_hash(i + k*p, p) == h) k++;
+                if (p*(k-1) > best_p*(best_k-1)) {
+                    best_p = p;
+                    best_k = k;
+                }
+            }
+            // Check the run, in case of a hash collision.
+            for (size_t k = 1; k < best_k; k++) {
+                if (!std::equal(seq.begin() + i, seq.begin() + i + best_p, seq.begin() + i + k*best_p)) {
+                    best_k = k;
+                    break;
+                }
+            }
+            // A run of two single statements is not worth a block.
+            if (best_p*(best_k-1) < 2) {
+                out.push_back(seq[i]);
+                i++;
+                continue;
+            }
+            // The body may have shorter periods of its own.
+            std::vector<uint64_t> body = reroll(std::vector<uint64_t>(seq.begin() + i, seq.begin() + i + best_p));
+            out.push_back(get_block_id(static_cast<int64_t>(best_k), std::move(body)));
+            i += best_p*best_k;
+        }
+        return out;
+    }
+
+    uint64_t
+    get_block_id(int64_t repeat_count, std::vector<uint64_t> body) {
+        auto [ it, is_new ] = block_ids.try_emplace(std::make_pair(repeat_count, body), nodes.size());
+        if (is_new) nodes.push_back({nullptr, repeat_count, std::move(body)});
+        return it->second;
+    }
+
+    block_t
+    make_block(const std::vector<uint64_t>& seq, int64_t repeat_count) {
+        block_t blk;
+        blk.repeat_count = repeat_count;
+        for (uint64_t id : seq) {
+            const node_t& x = nodes[id];
+            if (x.inst != nullptr) {
+                blk.instructions.push_back(*x.inst);
+            } else {
+                blk.subblock_pos.push_back(blk.instructions.size());
+                blk.subblocks.push_back(make_block(x.body, x.repeat_count));
+            }
+        }
+        return blk;
+    }
+
+    const Program<>& program;
+
+    std::vector<node_t> nodes;
+    std::map<std::pair<int64_t, std::vector<uint64_t>>, uint64_t> block_ids;
+    std::vector<uint64_t> pow;
+};
+
+block_t
+reroll_program(const Program<>& program) {
+    return Reroller(program).run();
+}
+
+static void
+print_block_into(const block_t& blk, std::string& out, size_t depth) {
+    if (blk.loop_var != block_t::NO_LOOP_VAR || blk.subroutine != nullptr) {
+        std::cerr << "[ qes ] print_block does not support loop variables or calls." << std::endl;
+        exit(1);
+    }
+    const std::string indent(4*depth, ' ');
+    auto put_line = [&] (const std::string& s) {
+        if (!out.empty()) out += "\n";
+        out += indent;
+        out += s;
+    };
+    for_each_statement(blk,
+        [&] (const Instruction<>& inst) {
+            // Annotations and properties are on their own lines.
+            std::string s = print_inst(inst, false);
+            size_t k = 0;
+            while ((k = s.find('\n', k)) != std::string::npos) {
+                s.insert(k+1, indent);
+                k += indent.size() + 1;
+            }
+            put_line(s);
+        },
+        [&] (const block_t& sub) {
+            if (sub.repeat_count == 1) {
+                print_block_into(sub, out, depth);
+                return;
+            }
+            put_line("repeat (" + std::to_string(sub.repeat_count) + ") {");
+            print_block_into(sub, out, depth+1);
+            put_line("}");
+        });
+}
+
+std::string
+print_block(const block_t& blk) {
+    std::string out;
+    if (blk.repeat_count == 1) {
+        print_block_into(blk, out, 0);
+    } else {
+        block_t top;
+        top.subblock_pos.push_back(0);
+        top.subblocks.push_back(blk);
+        print_block_into(top, out, 0);
+    }
+    return out;
+}
+
+void
+write_rerolled_prog(std::ostream& out, const Program<>& program) {
+    out << print_block(reroll_program(program));
+}
+
+}   // qes
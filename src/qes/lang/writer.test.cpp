@@ -0,0 +1,98 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ *
+ *  Fails if a program written rerolled (see qes/lang/writer.h) does not read
+ *  back as the same program, or is not smaller than the flat program.
+ * */
+
+#include <qes.h>
+
+#include <filesystem>
+#include <random>
+#include <sstream>
+
+#include <unistd.h>
+
+using namespace qes;
+namespace fs = std::filesystem;
+
+const size_t N_PROGRAMS = 20;
+
+// Returns a double with more significant digits than are printed by default.
+std::string
+random_digits(std::mt19937& rng) {
+    std::string x = std::to_string(rng() % 10) + ".";
+    for (size_t i = 0; i < 17; i++) x += static_cast<char>('0' + rng() % 10);
+    return x;
+}
+
+// Writes a random instruction, with a few annotations and properties.
+void
+write_instruction(std::ostream& out, std::mt19937& rng) {
+    const char* names[] = { "h", "cx", "measure", "rz" };
+    const size_t k = rng() % 4;
+    if (rng() % 4 == 0) out << "@annotation timing_error\n";
+    if (rng() % 4 == 0) out << "@property round " << rng() % 3 << "\n";
+    if (rng() % 8 == 0) out << "@property error_rate 0.001\n";
+    // A whole double must not be read back as an integer.
+    if (rng() % 8 == 0) out << "@property duration " << rng() % 3 << ".0\n";
+    out << names[k] << " " << rng() % 8;
+    if (k == 1) out << ", " << rng() % 8;
+    if (k == 3) out << ", " << (rng() % 2 ? "-" : "") << random_digits(rng);
+    out << ";\n";
+}
+
+// Writes a flat program of n statements: each is an instruction or (up to the
+// given depth) a run of copies of a random body.
+void
+write_flat_program(std::ostream& out, std::mt19937& rng, size_t n, int depth) {
+    for (size_t i = 0; i < n; i++) {
+        if (depth > 0 && rng() % 3 == 0) {
+            std::ostringstream body;
+            write_flat_program(body, rng, 1 + rng() % 4, depth-1);
+            const size_t n_copies = 2 + rng() % 10;
+            for (size_t j = 0; j < n_copies; j++) out << body.str();
+        } else {
+            write_instruction(out, rng);
+        }
+    }
+}
+
+bool
+check_round_trip(const fs::path& file, const Program<>& program, const std::string& flat) {
+    to_file(file.string(), program, write_mode_t::rerolled);
+    if (from_file(file.string()) != program) {
+        std::cerr << "[ qes ] " << file << " does not read back as the program written." << std::endl;
+        return false;
+    }
+    if (file.extension() != ".gz" && fs::file_size(file) >= flat.size()) {
+        std::cerr << "[ qes ] " << file << " is not smaller than the flat program." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    const fs::path dir = fs::temp_directory_path() / ("qes_writer_test." + std::to_string(getpid()));
+    fs::create_directories(dir);
+
+    bool ok = true;
+    for (size_t i = 0; i < N_PROGRAMS && ok; i++) {
+        std::mt19937 rng(i);
+        std::ostringstream out;
+        write_flat_program(out, rng, 20, 2);
+        // Every program has at least one run to reroll.
+        for (size_t j = 0; j < 100; j++) out << "cx " << j % 2 << ", 2;\n";
+        const std::string flat = out.str();
+
+        std::istringstream iss(flat);
+        const Program<> program = fast_read_program(iss);
+        ok &= check_round_trip(dir / "program.qes", program, flat);
+        if (compression_is_supported(compression_t::gzip)) {
+            ok &= check_round_trip(dir / "program.qes.gz", program, flat);
+        }
+    }
+    fs::remove_all(dir);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/util/alloc.h"
+
+namespace qes {
+
+// These are trivially initialized, so touching them from operator new is safe
+// even while a thread is starting up.
+static thread_local uint64_t    ALLOC_COUNT = 0;
+static thread_local uint64_t    ALLOC_BYTES = 0;
+static bool                     HOOK_INSTALLED = false;
+
+alloc_counters_t
+get_alloc_counters() {
+    alloc_counters_t c;
+    c.count = ALLOC_COUNT;
+    c.bytes = ALLOC_BYTES;
+    return c;
+}
+
+bool
+alloc_hook_is_installed() {
+    return HOOK_INSTALLED;
+}
+
+void
+record_allocation(size_t n) {
+    ALLOC_COUNT++;
+    ALLOC_BYTES += n;
+}
+
+void
+set_alloc_hook_installed() {
+    HOOK_INSTALLED = true;
+}
+
+}   // qes
@@ -0,0 +1,99 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ *
+ *  Fails if the number of allocations per instruction of either reader
+ *  regresses past its budget, or grows with the size of the program. Must be
+ *  linked with qes_alloc_hook.
+ * */
+
+#include <qes.h>
+#include <qes/util/alloc.h>
+
+#include <sstream>
+
+using namespace qes;
+
+// The budgets bound the allocations of each additional instruction: the
+// allocations of make_test_program(2*N_INSTRUCTIONS) less those of
+// make_test_program(N_INSTRUCTIONS), per instruction. This leaves out fixed
+// costs (e.g., the safe reader loads its grammar on every call). The budgets
+// are just above what each reader currently needs (2.11 and 652.9), so that
+// any increase fails; lower them when a change reduces allocations.
+//
+// The allocations of each additional instruction must also not grow (by more
+// than GROWTH_SLACK, as vectors grow in steps) on a program twice as long, so
+// that a reader whose allocations grow faster than linearly fails.
+const size_t N_INSTRUCTIONS = 64;
+const double FAST_READ_BUDGET = 2.12;
+const double SAFE_READ_BUDGET = 653.0;
+const double GROWTH_SLACK = 0.25;
+
+// The program is periodic (operands are below 10), so that each instruction
+// takes as many characters to write.
+std::string
+make_test_program(size_t n) {
+    std::ostringstream out;
+    for (size_t i = 0; i < n; i++) {
+        if (i % 8 == 0) out << "@annotation timing_error\n";
+        if (i % 16 == 0) out << "@property error_rate 0.001\n";
+        out << "cx " << i % 10 << ", " << (i+1) % 10 << ", " << (i+2) % 10 << ", " << (i+3) % 10 << ";\n";
+        if (i % 32 == 0) out << "repeat (4) {\n    h " << i % 10 << ";\n    measure " << i % 10 << ";\n}\n";
+    }
+    return out.str();
+}
+
+// Returns the number of allocations made by the reader, and the number of
+// instructions read.
+template <class FUNC> std::pair<uint64_t, uint64_t>
+count_allocations(FUNC read, size_t n) {
+    std::istringstream iss(make_test_program(n));
+    alloc_counters_t before = get_alloc_counters();
+    Program<> program = read(iss);
+    alloc_counters_t after = get_alloc_counters();
+    return { after.count - before.count, program.size() };
+}
+
+// Returns the allocations per instruction of the instructions of
+// make_test_program(2*n) that are not in make_test_program(n).
+template <class FUNC> double
+allocations_per_instruction(FUNC read, size_t n) {
+    const auto [ a1, n1 ] = count_allocations(read, n);
+    const auto [ a2, n2 ] = count_allocations(read, 2*n);
+    return static_cast<double>(a2 - a1) / (n2 - n1);
+}
+
+bool
+check(std::string name, double value, double budget) {
+    std::cout << name << ": " << value << " allocations per instruction (budget: "
+        << budget << ")" << std::endl;
+    if (value > budget) {
+        std::cerr << "[ qes ] " << name << " exceeded its allocation budget." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Checks the reader against its budget, and then against itself on a program
+// twice as long.
+template <class FUNC> bool
+check_reader(std::string name, FUNC read, double budget) {
+    const double x = allocations_per_instruction(read, N_INSTRUCTIONS);
+    bool ok = check(name, x, budget);
+    ok &= check(name + " (2x instructions)", allocations_per_instruction(read, 2*N_INSTRUCTIONS), x + GROWTH_SLACK);
+    return ok;
+}
+
+int main() {
+    if (!alloc_hook_is_installed()) {
+        std::cerr << "[ qes ] test_alloc must be linked with qes_alloc_hook." << std::endl;
+        return 1;
+    }
+    bool ok = true;
+    ok &= check_reader("fast_read_program", [] (std::istream& in) { return fast_read_program(in); }, FAST_READ_BUDGET);
+    ok &= check_reader("safe_read_program", [] (std::istream& in) { return safe_read_program(in); }, SAFE_READ_BUDGET);
+
+    std::istringstream iss(make_test_program(N_INSTRUCTIONS));
+    std::cout << "footprint: " << memory_footprint(fast_read_program(iss)) << std::endl;
+    return ok ? 0 : 1;
+}
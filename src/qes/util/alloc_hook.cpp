@@ -0,0 +1,31 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+// Replaces the global operator new and delete to count allocations (see
+// qes/util/alloc.h). This file is only linked in by executables that want
+// allocation accounting (the qes_alloc_hook target).
+
+#include "qes/util/alloc.h"
+
+#include <new>
+
+#include <stdlib.h>
+
+static void*
+counted_malloc(size_t n) {
+    qes::record_allocation(n);
+    void* p = malloc(n == 0 ? 1 : n);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t n)                                    { return counted_malloc(n); }
+void* operator new[](size_t n)                                  { return counted_malloc(n); }
+void operator delete(void* p) noexcept                          { free(p); }
+void operator delete[](void* p) noexcept                        { free(p); }
+void operator delete(void* p, size_t) noexcept                  { free(p); }
+void operator delete[](void* p, size_t) noexcept                { free(p); }
+
+static const bool HOOK_REGISTERED = (qes::set_alloc_hook_installed(), true);
@@ -0,0 +1,411 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/util/compression.h"
+#include "qes/util/readahead.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef QES_USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef QES_USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace qes {
+
+// Pipes and FIFOs can only be read once, so they are not sniffed for magic
+// bytes (which would consume them) or read ahead (which uses pread).
+static bool
+is_regular_file(const std::string& file) {
+    struct stat sb;
+    return stat(file.c_str(), &sb) == 0 && S_ISREG(sb.st_mode);
+}
+
+compression_t
+detect_compression(std::string file) {
+    if (!is_regular_file(file)) return compression_from_extension(file);
+    FILE* fp = fopen(file.c_str(), "rb");
+    if (fp == NULL) return compression_from_extension(file);
+
+    unsigned char magic[4] = {0, 0, 0, 0};
+    size_t n = fread(magic, 1, 4, fp);
+    fclose(fp);
+
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return compression_t::gzip;
+    } else if (n == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        return compression_t::zstd;
+    }
+    return compression_t::none;
+}
+
+bool
+compression_is_supported(compression_t type) {
+    if (type == compression_t::gzip) {
+#ifdef QES_USE_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    } else if (type == compression_t::zstd) {
+#ifdef QES_USE_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+    return true;
+}
+
+void
+test_compression_is_supported(compression_t type, std::string file) {
+    if (compression_is_supported(type)) return;
+    const bool is_gzip = (type == compression_t::gzip);
+    std::cerr << "[ qes ] \"" << file << "\" is " << (is_gzip ? "gzip" : "zstd")
+        << "-compressed, but qes was built without " << (is_gzip ? "zlib" : "zstd")
+        << "." << std::endl;
+    exit(1);
+}
+
+static FILE*
+open_or_exit(std::string file, const char* mode) {
+    FILE* fp = fopen(file.c_str(), mode);
+    if (fp == NULL) {
+        std::cerr << "[ qes ] could not open \"" << file << "\"." << std::endl;
+        exit(1);
+    }
+    return fp;
+}
+
+static void
+exit_on_corrupt_input(std::string reason) {
+    std::cerr << "[ qes ] failed to decompress input: " << reason << std::endl;
+    exit(1);
+}
+
+static void
+exit_on_compress_error(std::string reason) {
+    std::cerr << "[ qes ] failed to compress output: " << reason << std::endl;
+    exit(1);
+}
+
+static void
+write_or_exit(const char* data, size_t n, FILE* fp) {
+    if (fwrite(data, 1, n, fp) != n) exit_on_compress_error("could not write to the file");
+}
+
+//
+// DecompressStreambuf
+//
+
+DecompressStreambuf::DecompressStreambuf(std::string file, compression_t t,
+                                            size_t block_size, size_t max_blocks)
+    :fp(nullptr),
+    type(t),
+    block_size(block_size),
+    max_blocks(max_blocks),
+    curr_block(),
+    blocks(),
+    done(false),
+    stop(false),
+    mtx(),
+    cv(),
+    worker()
+{
+    test_compression_is_supported(type, file);
+    fp = open_or_exit(file, "rb");
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fileno(fp), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    worker = std::thread([this] () { run(); });
+}
+
+DecompressStreambuf::~DecompressStreambuf() {
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        stop = true;
+    }
+    cv.notify_all();
+    worker.join();
+    fclose(fp);
+}
+
+DecompressStreambuf::int_type
+DecompressStreambuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [this] () { return !blocks.empty() || done; });
+        if (blocks.empty()) return traits_type::eof();
+        curr_block = std::move(blocks.front());
+        blocks.pop_front();
+    }
+    cv.notify_all();
+    setg(curr_block.data(), curr_block.data(), curr_block.data() + curr_block.size());
+    return traits_type::to_int_type(*gptr());
+}
+
+void
+DecompressStreambuf::run() {
+    if (type == compression_t::gzip)        run_gzip();
+    else if (type == compression_t::zstd)   run_zstd();
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        done = true;
+    }
+    cv.notify_all();
+}
+
+void
+DecompressStreambuf::run_gzip() {
+#ifdef QES_USE_ZLIB
+    z_stream zs{};
+    // 15+32 auto-detects the gzip or zlib header.
+    if (inflateInit2(&zs, 15+32) != Z_OK) exit_on_corrupt_input("could not initialize zlib");
+
+    std::vector<unsigned char> in(block_size);
+    std::vector<char> out(block_size);
+    size_t out_used = 0;
+    bool in_member = false;
+    while (!stop) {
+        if (zs.avail_in == 0) {
+            size_t n = fread(in.data(), 1, in.size(), fp);
+            if (n == 0) break;
+            zs.next_in = in.data();
+            zs.avail_in = n;
+        }
+        zs.next_out = reinterpret_cast<Bytef*>(out.data() + out_used);
+        zs.avail_out = out.size() - out_used;
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        out_used = out.size() - zs.avail_out;
+        if (ret == Z_STREAM_END) {
+            // There may be more gzip members afterwards (i.e. concatenated files).
+            inflateReset(&zs);
+            in_member = false;
+        } else if (ret == Z_OK || ret == Z_BUF_ERROR) {
+            in_member = true;
+        } else {
+            exit_on_corrupt_input(zs.msg == NULL ? "zlib error" : zs.msg);
+        }
+
+        if (out_used == out.size()) {
+            push_block(std::move(out));
+            out = std::vector<char>(block_size);
+            out_used = 0;
+        }
+    }
+    if (in_member && !stop) exit_on_corrupt_input("unexpected end of gzip stream");
+    if (out_used > 0) {
+        out.resize(out_used);
+        push_block(std::move(out));
+    }
+    inflateEnd(&zs);
+#endif
+}
+
+void
+DecompressStreambuf::run_zstd() {
+#ifdef QES_USE_ZSTD
+    ZSTD_DCtx* dctx = ZSTD_createDCtx();
+    if (dctx == nullptr) exit_on_corrupt_input("could not initialize zstd");
+
+    std::vector<char> in(ZSTD_DStreamInSize());
+    std::vector<char> out(block_size);
+    size_t out_used = 0;
+
+    ZSTD_inBuffer zin = { in.data(), 0, 0 };
+    size_t last_ret = 0;
+    while (!stop) {
+        if (zin.pos == zin.size) {
+            size_t n = fread(in.data(), 1, in.size(), fp);
+            if (n == 0) break;
+            zin.size = n;
+            zin.pos = 0;
+        }
+        ZSTD_outBuffer zout = { out.data() + out_used, out.size() - out_used, 0 };
+        size_t ret = ZSTD_decompressStream(dctx, &zout, &zin);
+        if (ZSTD_isError(ret)) exit_on_corrupt_input(ZSTD_getErrorName(ret));
+        last_ret = ret;
+        out_used += zout.pos;
+
+        if (out_used == out.size()) {
+            push_block(std::move(out));
+            out = std::vector<char>(block_size);
+            out_used = 0;
+        }
+    }
+    if (last_ret != 0 && !stop) exit_on_corrupt_input("unexpected end of zstd stream");
+    if (out_used > 0) {
+        out.resize(out_used);
+        push_block(std::move(out));
+    }
+    ZSTD_freeDCtx(dctx);
+#endif
+}
+
+void
+DecompressStreambuf::push_block(std::vector<char>&& blk) {
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [this] () { return blocks.size() < max_blocks || stop; });
+        if (stop) return;
+        blocks.push_back(std::move(blk));
+    }
+    cv.notify_all();
+}
+
+//
+// CompressStreambuf
+//
+
+CompressStreambuf::CompressStreambuf(std::string file, compression_t t, size_t block_size)
+    :fp(nullptr),
+    type(t),
+    ctx(nullptr),
+    in_buf(block_size),
+    out_buf(block_size)
+{
+    test_compression_is_supported(type, file);
+    fp = open_or_exit(file, "wb");
+#ifdef QES_USE_ZLIB
+    if (type == compression_t::gzip) {
+        z_stream* zs = new z_stream{};
+        // 15+16 writes a gzip (rather than zlib) header.
+        if (deflateInit2(zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15+16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            exit_on_compress_error("could not initialize zlib");
+        }
+        ctx = zs;
+    }
+#endif
+#ifdef QES_USE_ZSTD
+    if (type == compression_t::zstd) {
+        ctx = ZSTD_createCCtx();
+        if (ctx == nullptr) exit_on_compress_error("could not initialize zstd");
+    }
+#endif
+    setp(in_buf.data(), in_buf.data() + in_buf.size());
+}
+
+CompressStreambuf::~CompressStreambuf() {
+    compress_buffer(true);
+#ifdef QES_USE_ZLIB
+    if (type == compression_t::gzip) {
+        z_stream* zs = static_cast<z_stream*>(ctx);
+        deflateEnd(zs);
+        delete zs;
+    }
+#endif
+#ifdef QES_USE_ZSTD
+    if (type == compression_t::zstd) {
+        ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(ctx));
+    }
+#endif
+    fclose(fp);
+}
+
+CompressStreambuf::int_type
+CompressStreambuf::overflow(int_type c) {
+    compress_buffer(false);
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int
+CompressStreambuf::sync() {
+    compress_buffer(false);
+    fflush(fp);
+    return 0;
+}
+
+void
+CompressStreambuf::compress_buffer(bool finish) {
+#ifdef QES_USE_ZLIB
+    if (type == compression_t::gzip) {
+        z_stream* zs = static_cast<z_stream*>(ctx);
+        zs->next_in = reinterpret_cast<Bytef*>(pbase());
+        zs->avail_in = pptr() - pbase();
+        int ret;
+        do {
+            zs->next_out = reinterpret_cast<Bytef*>(out_buf.data());
+            zs->avail_out = out_buf.size();
+            ret = deflate(zs, finish ? Z_FINISH : Z_NO_FLUSH);
+            if (ret == Z_STREAM_ERROR) exit_on_compress_error(zs->msg == NULL ? "zlib error" : zs->msg);
+            write_or_exit(out_buf.data(), out_buf.size() - zs->avail_out, fp);
+        } while (finish ? (ret != Z_STREAM_END) : (zs->avail_in > 0 || zs->avail_out == 0));
+    }
+#endif
+#ifdef QES_USE_ZSTD
+    if (type == compression_t::zstd) {
+        ZSTD_CCtx* cctx = static_cast<ZSTD_CCtx*>(ctx);
+        ZSTD_inBuffer zin = { pbase(), static_cast<size_t>(pptr() - pbase()), 0 };
+        size_t remaining;
+        do {
+            ZSTD_outBuffer zout = { out_buf.data(), out_buf.size(), 0 };
+            remaining = ZSTD_compressStream2(cctx, &zout, &zin, finish ? ZSTD_e_end : ZSTD_e_continue);
+            if (ZSTD_isError(remaining)) exit_on_compress_error(ZSTD_getErrorName(remaining));
+            write_or_exit(out_buf.data(), zout.pos, fp);
+        } while (finish ? (remaining != 0) : (zin.pos < zin.size));
+    }
+#endif
+    setp(in_buf.data(), in_buf.data() + in_buf.size());
+}
+
+//
+// compressed_ifstream and compressed_ofstream
+//
+
+compressed_ifstream::compressed_ifstream(std::string file)
+    :std::istream(nullptr),
+    buf(nullptr)
+{
+    compression_t type = detect_compression(file);
+    if (type == compression_t::none && get_read_ahead_depth() > 0 && is_regular_file(file)) {
+        ReadAheadStreambuf* rb = new ReadAheadStreambuf(file,
+                                        get_read_ahead_block_size(), get_read_ahead_depth());
+        buf.reset(rb);
+        rdbuf(rb);
+        if (!rb->is_open()) setstate(std::ios::failbit);
+        return;
+    } else if (type == compression_t::none) {
+        std::filebuf* fb = new std::filebuf;
+        buf.reset(fb);
+        if (fb->open(file, std::ios::in) == nullptr) {
+            rdbuf(fb);
+            setstate(std::ios::failbit);
+            return;
+        }
+    } else {
+        buf.reset(new DecompressStreambuf(file, type));
+    }
+    rdbuf(buf.get());
+}
+
+compressed_ofstream::compressed_ofstream(std::string file)
+    :std::ostream(nullptr),
+    buf(nullptr)
+{
+    compression_t type = compression_from_extension(file);
+    if (type == compression_t::none) {
+        std::filebuf* fb = new std::filebuf;
+        buf.reset(fb);
+        if (fb->open(file, std::ios::out) == nullptr) {
+            rdbuf(fb);
+            setstate(std::ios::failbit);
+            return;
+        }
+    } else {
+        buf.reset(new CompressStreambuf(file, type));
+    }
+    rdbuf(buf.get());
+}
+
+}   // qes
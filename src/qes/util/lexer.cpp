@@ -16,7 +16,10 @@ Lexer::Lexer(std::string lexer_file)
     :token_order(),
     regex_map(),
     token_ignore_set(),
-    tokens()
+    literal_map(),
+    tokens(),
+    bytes_read(0),
+    positions()
 {
     // Read tokens from token file.
     if (faccessat(AT_FDCWD, lexer_file.c_str(), F_OK, 0) != 0) {
@@ -56,7 +59,8 @@ Lexer::Lexer(std::string lexer_file)
         }
         if (token_name.empty()) continue;
         // Check if the token is a literal.
-        if (is_keyword || token_regex.empty()) {
+        const bool is_literal = is_keyword || token_regex.empty();
+        if (is_literal) {
             const std::string special_chars = R"_(*+[](){}.\|^)_";
             for (size_t i = 0; i < token_name.size(); i++) {
                 char c = token_name[i];
@@ -66,6 +70,7 @@ Lexer::Lexer(std::string lexer_file)
                 token_regex.push_back(c);
             }
         }
+        if (is_literal) literal_map[is_keyword ? "KW_" + token_name : token_name] = token_name;
         // Update token_name with a prefix.
         if (is_keyword) token_name = "KW_" + token_name;
         // Update data structures.
@@ -86,12 +91,21 @@ Lexer::read_tokens(std::istream& input) {
 
     bool get_char = true;
     char c;
+    // The positions of the next character, of c, and of the start of curr_token.
+    token_pos_t next_pos{1, 1},
+                c_pos{1, 1},
+                curr_pos{1, 1};
     while (!input.eof() || !get_char) {
         // Update curr token.
         prev_token = curr_token;
         if (get_char) {
             c = input.get();
+            c_pos = next_pos;
+            if (curr_token.empty()) curr_pos = c_pos;
             curr_token.push_back(c);
+            if (!input.eof()) bytes_read++;
+            if (c == '\n') next_pos = {next_pos.line+1, 1};
+            else            next_pos.col++;
         }
         get_char = false;
         // Recheck token regex.
@@ -110,10 +124,12 @@ Lexer::read_tokens(std::istream& input) {
             } else {
                 if (!token_ignore_set.count(type)) {
                     tokens.push_back(std::make_tuple(type, prev_token));
+                    if (record_positions) positions.push_back(curr_pos);
                 }
             }
             // Reset curr_token to just c.
             curr_token.erase(0, prev_token.size());
+            curr_pos = c_pos;
             type = T_undefined;
             continue;
         }
@@ -124,6 +140,7 @@ match_found:
     if (curr_token.size() > 0) {
         if (type != T_undefined && !token_ignore_set.count(type)) {
             tokens.push_back(std::make_tuple(type, curr_token));
+            if (record_positions) positions.push_back(curr_pos);
         }
     }
 }
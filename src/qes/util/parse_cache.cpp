@@ -0,0 +1,221 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/lang/binary.h"
+#include "qes/lang/fast_parse.h"
+#include "qes/lang/module.h"
+#include "qes/util/compression.h"
+#include "qes/util/parse_cache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <string.h>
+#include <unistd.h>
+
+namespace qes {
+
+namespace fs = std::filesystem;
+
+static std::mutex   CACHE_MTX;
+static std::string  CACHE_DIRECTORY;
+static size_t       CACHE_MAX_BYTES = 0;
+static bool         CACHE_ENABLED = false;
+
+static const std::string CACHE_ENTRY_EXT = ".qesb";
+
+void
+enable_parse_cache(std::string directory, size_t max_bytes) {
+    std::lock_guard<std::mutex> lk(CACHE_MTX);
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec) {
+        std::cerr << "[ qes ] could not create parse cache directory \"" << directory
+            << "\": " << ec.message() << std::endl;
+        exit(1);
+    }
+    CACHE_DIRECTORY = directory;
+    CACHE_MAX_BYTES = max_bytes;
+    CACHE_ENABLED = true;
+}
+
+void
+disable_parse_cache() {
+    std::lock_guard<std::mutex> lk(CACHE_MTX);
+    CACHE_ENABLED = false;
+}
+
+bool
+parse_cache_is_enabled() {
+    std::lock_guard<std::mutex> lk(CACHE_MTX);
+    return CACHE_ENABLED;
+}
+
+static inline uint64_t
+rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64-r));
+}
+
+static inline uint64_t
+fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+std::string
+hash_bytes(const char* data, size_t n) {
+    // Two independent MurmurHash3-style lanes over 8-byte words.
+    const uint64_t c1 = 0x87c37b91114253d5ULL,
+                    c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = 0x9e3779b97f4a7c15ULL ^ n,
+             h2 = 0xc2b2ae3d27d4eb4fULL ^ n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t k;
+        memcpy(&k, data + i, 8);
+        h1 ^= rotl(k * c1, 31) * c2;
+        h1 = rotl(h1, 27) * 5 + 0x52dce729;
+        h2 ^= rotl(k * c2, 33) * c1;
+        h2 = rotl(h2, 31) * 5 + 0x38495ab5;
+    }
+    uint64_t k = 0;
+    memcpy(&k, data + i, n - i);
+    h1 ^= rotl(k * c1, 31) * c2;
+    h2 ^= rotl(k * c2, 33) * c1;
+
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+
+    char buf[33];
+    snprintf(buf, sizeof(buf), "%016llx%016llx",
+            static_cast<unsigned long long>(h1), static_cast<unsigned long long>(h2));
+    return std::string(buf);
+}
+
+std::string
+get_parse_cache_key(const std::string& contents) {
+#ifndef QES_VERSION
+#define QES_VERSION "unknown"
+#endif
+#ifndef QES_GRAMMAR_VERSION
+#define QES_GRAMMAR_VERSION "unknown"
+#endif
+    return hash_bytes(contents.data(), contents.size())
+        + "-" + QES_VERSION
+        + "-" + QES_GRAMMAR_VERSION
+        + "-" + std::to_string(QES_BINARY_FORMAT_VERSION);
+}
+
+static void
+evict_entries(std::string directory, size_t max_bytes) {
+    std::vector<std::pair<fs::file_time_type, fs::path>> entries;
+    size_t total_bytes = 0;
+
+    std::error_code ec;
+    for (const auto& e : fs::directory_iterator(directory, ec)) {
+        if (e.path().extension() != CACHE_ENTRY_EXT) continue;
+        // Another process may have removed the entry in the meantime.
+        size_t sz = e.file_size(ec);
+        if (ec) continue;
+        auto t = e.last_write_time(ec);
+        if (ec) continue;
+        total_bytes += sz;
+        entries.emplace_back(t, e.path());
+    }
+    if (total_bytes <= max_bytes) return;
+    // Evict least recently used entries first.
+    std::sort(entries.begin(), entries.end());
+    for (const auto& [ t, p ] : entries) {
+        if (total_bytes <= max_bytes) break;
+        size_t sz = fs::file_size(p, ec);
+        if (ec) continue;
+        if (fs::remove(p, ec)) total_bytes -= sz;
+    }
+}
+
+Program<>
+cached_read_from_file(std::string file) {
+    std::string directory;
+    size_t max_bytes;
+    {
+        std::lock_guard<std::mutex> lk(CACHE_MTX);
+        directory = CACHE_DIRECTORY;
+        max_bytes = CACHE_MAX_BYTES;
+    }
+    // Read the raw bytes of the file for hashing.
+    std::ifstream raw(file, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(raw)), std::istreambuf_iterator<char>());
+
+    const std::string key = get_parse_cache_key(contents);
+    const fs::path entry = fs::path(directory) / (key + CACHE_ENTRY_EXT);
+    // Look up the entry.
+    {
+        std::ifstream fin(entry, std::ios::binary);
+        if (fin.good() && read_binary_header(fin)) {
+            Program<> program;
+            Instruction<> inst;
+            while (read_binary_inst(fin, inst)) program.push_back(std::move(inst));
+            std::error_code ec;
+            if (!fin.fail()) {
+                // Mark the entry as recently used.
+                fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+                return program;
+            }
+            // The entry is corrupt or truncated: drop it and parse the file.
+            fin.close();
+            fs::remove(entry, ec);
+        }
+    }
+    // Cache miss: parse the file.
+    Program<> program;
+    const uint64_t n_includes = get_number_of_includes();
+    {
+        IncludeGuard guard(file);
+        if (detect_compression(file) == compression_t::none) {
+            std::istringstream iss(std::move(contents));
+            program = fast_read_program(iss);
+        } else {
+            compressed_ifstream fin(file);
+            program = fast_read_program(fin);
+        }
+    }
+    // The key only covers this file, so programs that include other files
+    // (see qes/lang/module.h) are not cached.
+    if (get_number_of_includes() != n_includes) return program;
+    // Write the entry to a unique temporary file and move it into place.
+    std::ostringstream tmp_name;
+    tmp_name << key << ".tmp." << getpid() << "." << std::this_thread::get_id();
+    const fs::path tmp = fs::path(directory) / tmp_name.str();
+    {
+        std::ofstream fout(tmp, std::ios::binary);
+        write_binary_program(fout, program);
+        // Closing flushes the stream, which may also fail.
+        fout.close();
+        if (fout.fail()) {
+            std::error_code ec;
+            fs::remove(tmp, ec);
+            return program;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, entry, ec);
+    if (ec) fs::remove(tmp, ec);
+
+    evict_entries(directory, max_bytes);
+    return program;
+}
+
+}   // qes
@@ -0,0 +1,38 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/util/profile.h"
+
+#include <sstream>
+
+namespace qes {
+
+std::string
+to_json(const io_stats_t& stats) {
+    std::ostringstream out;
+#ifdef QES_PROFILE
+    out << "{\"enabled\":true,\"phases\":[";
+#else
+    out << "{\"enabled\":false,\"phases\":[";
+#endif
+    bool first = true;
+    for (const auto& [ name, ph ] : stats.phases) {
+        if (!first) out << ",";
+        first = false;
+        // Phase names are internal identifiers, so they never need escaping.
+        out << "{\"name\":\"" << name << "\""
+            << ",\"wall_time_ns\":" << ph.wall_time_ns
+            << ",\"tokens\":" << ph.tokens
+            << ",\"instructions\":" << ph.instructions
+            << ",\"bytes\":" << ph.bytes
+            << ",\"allocations\":" << ph.allocations
+            << ",\"allocated_bytes\":" << ph.allocated_bytes
+            << "}";
+    }
+    out << "]}";
+    return out.str();
+}
+
+}   // qes
@@ -0,0 +1,191 @@
+/*
+ *  author: Suhas Vittal
+ *  date:   19 October 2026
+ * */
+
+#include "qes/util/readahead.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace qes {
+
+static std::atomic<size_t> READ_AHEAD_BLOCK_SIZE(1 << 20);
+static std::atomic<size_t> READ_AHEAD_DEPTH(3);
+
+void
+set_read_ahead(size_t block_size, size_t depth) {
+    READ_AHEAD_BLOCK_SIZE = std::max(block_size, size_t(1));
+    READ_AHEAD_DEPTH = depth;
+}
+
+size_t
+get_read_ahead_block_size() {
+    return READ_AHEAD_BLOCK_SIZE;
+}
+
+size_t
+get_read_ahead_depth() {
+    return READ_AHEAD_DEPTH;
+}
+
+ReadAheadStreambuf::ReadAheadStreambuf(std::string file, size_t block_size, size_t depth)
+    :fd(-1),
+    block_size(std::max(block_size, size_t(1))),
+    depth(std::max(depth, size_t(1))),
+    curr_block(),
+    curr_block_offset(0),
+    blocks(),
+    free_blocks(),
+    done(false),
+    stopped(false),
+    mtx(),
+    cv(),
+    worker()
+{
+    fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    // The worker reads with pread, which fails on pipes.
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+        close(fd);
+        fd = -1;
+        return;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    start(0);
+}
+
+ReadAheadStreambuf::~ReadAheadStreambuf() {
+    if (fd < 0) return;
+    stop();
+    close(fd);
+}
+
+bool
+ReadAheadStreambuf::is_open() const {
+    return fd >= 0;
+}
+
+ReadAheadStreambuf::int_type
+ReadAheadStreambuf::underflow() {
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+    if (fd < 0) return traits_type::eof();
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [this] () { return !blocks.empty() || done; });
+        if (blocks.empty()) return traits_type::eof();
+        // The current block is done, so the worker can reuse it.
+        curr_block_offset += curr_block.size;
+        if (!curr_block.data.empty()) free_blocks.push_back(std::move(curr_block));
+        curr_block = std::move(blocks.front());
+        blocks.pop_front();
+    }
+    cv.notify_all();
+    char* base = curr_block.data.data();
+    setg(base, base, base + curr_block.size);
+    return traits_type::to_int_type(*gptr());
+}
+
+ReadAheadStreambuf::pos_type
+ReadAheadStreambuf::seekoff(off_type off, std::ios::seekdir dir, std::ios::openmode which) {
+    if (fd < 0 || !(which & std::ios::in)) return pos_type(off_type(-1));
+    off_type base;
+    if (dir == std::ios::beg) {
+        base = 0;
+    } else if (dir == std::ios::cur) {
+        base = curr_block_offset + (gptr() - eback());
+        // tellg() should not restart the worker.
+        if (off == 0) return pos_type(base);
+    } else {
+        base = lseek(fd, 0, SEEK_END);
+    }
+    return seekpos(pos_type(base + off), which);
+}
+
+ReadAheadStreambuf::pos_type
+ReadAheadStreambuf::seekpos(pos_type pos, std::ios::openmode which) {
+    if (fd < 0 || !(which & std::ios::in) || off_type(pos) < 0) return pos_type(off_type(-1));
+    const uint64_t offset = off_type(pos);
+    // If the position is in the current block, there is no need to restart.
+    if (offset >= curr_block_offset && offset < curr_block_offset + curr_block.size) {
+        char* base = curr_block.data.data();
+        setg(base, base + (offset - curr_block_offset), base + curr_block.size);
+        return pos;
+    }
+    stop();
+    start(offset);
+    return pos;
+}
+
+void
+ReadAheadStreambuf::start(uint64_t offset) {
+    curr_block_offset = offset;
+    curr_block.size = 0;
+    setg(nullptr, nullptr, nullptr);
+    done = false;
+    stopped = false;
+    worker = std::thread([this, offset] () { run(offset); });
+}
+
+void
+ReadAheadStreambuf::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        stopped = true;
+    }
+    cv.notify_all();
+    worker.join();
+    // Any read-ahead blocks are stale now.
+    while (!blocks.empty()) {
+        free_blocks.push_back(std::move(blocks.front()));
+        blocks.pop_front();
+    }
+}
+
+void
+ReadAheadStreambuf::run(uint64_t offset) {
+    while (true) {
+        block_t blk;
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            cv.wait(lk, [this] () { return blocks.size() < depth || stopped; });
+            if (stopped) return;
+            if (!free_blocks.empty()) {
+                blk = std::move(free_blocks.back());
+                free_blocks.pop_back();
+            }
+        }
+        blk.data.resize(block_size);
+        // Fill the block (read may return less than requested).
+        size_t n = 0;
+        while (n < block_size) {
+            ssize_t r = pread(fd, blk.data.data() + n, block_size - n, offset + n);
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0) {
+                std::cerr << "[ qes ] read failed at offset " << (offset + n) << "." << std::endl;
+                exit(1);
+            }
+            if (r == 0) break;
+            n += r;
+        }
+        blk.size = n;
+        offset += n;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (n > 0) blocks.push_back(std::move(blk));
+            if (n < block_size) done = true;
+        }
+        cv.notify_all();
+        if (n < block_size) return;
+    }
+}
+
+}   // qes